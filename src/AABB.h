@@ -0,0 +1,48 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include <algorithm>
+#include <cmath>
+
+#include "Vector3.h"
+
+// Caixa delimitadora alinhada aos eixos, usada pelas estruturas de aceleração
+struct AABB {
+    Vector3 min = {INFINITY, INFINITY, INFINITY};
+    Vector3 max = {-INFINITY, -INFINITY, -INFINITY};
+
+    void grow(const Vector3 &point) {
+        min = {std::min(min.x, point.x), std::min(min.y, point.y), std::min(min.z, point.z)};
+        max = {std::max(max.x, point.x), std::max(max.y, point.y), std::max(max.z, point.z)};
+    }
+
+    // União das caixas. Uma caixa vazia não altera o resultado
+    void grow(const AABB &other) {
+        min = {std::min(min.x, other.min.x), std::min(min.y, other.min.y), std::min(min.z, other.min.z)};
+        max = {std::max(max.x, other.max.x), std::max(max.y, other.max.y), std::max(max.z, other.max.z)};
+    }
+
+    bool empty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+
+    Vector3 center() const { return (min + max) * 0.5F; }
+    Vector3 extent() const { return max - min; }
+
+    // Eixo de maior extensão
+    int largest_axis() const {
+        const Vector3 e = extent();
+        if (e.x >= e.y && e.x >= e.z) {
+            return 0;
+        }
+        return e.y >= e.z ? 1 : 2;
+    }
+
+    float surface_area() const {
+        if (empty()) {
+            return 0.0F;
+        }
+        const Vector3 e = extent();
+        return 2.0F * (e.x * e.y + e.y * e.z + e.z * e.x);
+    }
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef ACCELERATOR_H
+#define ACCELERATOR_H
+
+#include "Ray.h"
+#include "TriangleStore.h"
+
+class ThreadPool;
+
+// Interface comum das estruturas de aceleração construídas sobre o armazenamento de triângulos
+class Accelerator {
+  public:
+    virtual ~Accelerator() = default;
+
+    virtual const char *name() const = 0;
+
+    // Constrói a estrutura, que pode reordenar os triângulos do armazenamento.
+    // O armazenamento deve continuar vivo enquanto a estrutura for usada.
+    // O pool é o mesmo da renderização e pode ser usado para paralelizar a construção
+    virtual void build(TriangleStore &store, ThreadPool &pool) = 0;
+
+    // Interseção mais próxima, retorna o índice do triângulo no armazenamento
+    virtual bool intersect(const Ray &ray, float &closest_t, int &closest_idx) const = 0;
+
+    // Interseção mais próxima para cada raio do pacote, por padrão raio a raio
+    virtual void intersect_packet(RayPacket &packet) const {
+        for (int i = 0; i < packet.size; i++) {
+            intersect(packet.rays[i], packet.t[i], packet.index[i]);
+        }
+    }
+
+    // Consulta de oclusão, retorna ao encontrar qualquer triângulo antes de t_max
+    virtual bool occluded(const Ray &ray, float t_max) const = 0;
+};
+
+#endif
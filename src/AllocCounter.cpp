@@ -0,0 +1,54 @@
+#include "AllocCounter.h"
+
+#ifdef RAYCAST_COUNT_ALLOCS
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+static thread_local uint64_t t_allocations = 0;
+
+uint64_t heap_allocation_count() { return t_allocations; }
+
+static void *counted_alloc(std::size_t size, std::size_t alignment) {
+    t_allocations++;
+    if (size == 0) {
+        size = 1;
+    }
+    if (alignment > alignof(std::max_align_t)) {
+        return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    }
+    return std::malloc(size);
+}
+
+void *operator new(std::size_t size) {
+    if (void *ptr = counted_alloc(size, 0)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+void *operator new[](std::size_t size) { return operator new(size); }
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    if (void *ptr = counted_alloc(size, static_cast<std::size_t>(alignment))) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+void *operator new[](std::size_t size, std::align_val_t alignment) { return operator new(size, alignment); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept { return counted_alloc(size, 0); }
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept { return counted_alloc(size, 0); }
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+#else
+
+uint64_t heap_allocation_count() { return 0; }
+
+#endif
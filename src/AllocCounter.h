@@ -0,0 +1,12 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <cstdint>
+
+// Contador de alocações no heap para verificar que a renderização não aloca.
+// Só conta quando compilado com RAYCAST_COUNT_ALLOCS (make ALLOC_CHECK=1),
+// que substitui o operator new global; caso contrário sempre retorna 0.
+// A contagem é por thread, alocações de outras threads (como a do GLUT) não interferem
+uint64_t heap_allocation_count();
+
+#endif
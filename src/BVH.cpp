@@ -0,0 +1,823 @@
+#include "BVH.h"
+#include "SimdIntersect.h"
+#include "Stats.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <numeric>
+
+// Teste de intervalo entre um pacote coerente e a caixa. Usa os extremos do inverso
+// das direções para obter a menor entrada e a maior saída possíveis entre todos os raios,
+// retorna INFINITY apenas quando nenhum raio do pacote pode atingir a caixa antes de t_max
+static inline float intersect_aabb_packet(const AABB &box, const RayPacket &packet, float t_max) {
+    float t_near = 0.0F;
+    float t_far = t_max * slab_far_scale;
+    for (int axis = 0; axis < 3; axis++) {
+        const bool positive = packet.inv_min[axis] > 0.0F;
+        const float near_dist = (positive ? box.min[axis] : box.max[axis]) - packet.origin[axis];
+        const float far_dist = (positive ? box.max[axis] : box.min[axis]) - packet.origin[axis];
+        t_near = std::max(t_near, near_dist * (near_dist >= 0.0F ? packet.inv_min[axis] : packet.inv_max[axis]));
+        t_far = std::min(t_far, far_dist * (far_dist >= 0.0F ? packet.inv_max[axis] : packet.inv_min[axis]) *
+                                    slab_far_scale);
+    }
+    return t_near <= t_far ? t_near : INFINITY;
+}
+
+// Estado compartilhado da construção. Caixas e centróides são calculados uma única vez,
+// cada subárvore reordena apenas o seu intervalo de índices
+struct BVH::BuildContext {
+    std::vector<AABB> bounds;
+    std::vector<Vector3> centroids;
+    std::vector<uint32_t> &indices;
+    BVHBuildMode mode;
+    std::vector<uint32_t> codes; // Códigos de Morton na ordem de indices, apenas nos modos rápidos
+};
+
+// Caixas e contagens dos bins dos três eixos sobre um intervalo de triângulos
+struct BVH::Bins {
+    AABB bounds[3][bin_count];
+    uint32_t counts[3][bin_count] = {};
+
+    void merge(const Bins &other) {
+        for (int axis = 0; axis < 3; axis++) {
+            for (int bin = 0; bin < bin_count; bin++) {
+                bounds[axis][bin].grow(other.bounds[axis][bin]);
+                counts[axis][bin] += other.counts[axis][bin];
+            }
+        }
+    }
+};
+
+// Executa scan(primeiro, quantidade, parcial) sobre blocos do intervalo e junta os parciais na ordem
+// dos blocos. União de caixas e soma de contagens são exatas, então o resultado é o mesmo da versão serial
+template <typename Result, typename Scan>
+static void parallel_scan(ThreadPool *pool, uint32_t first, uint32_t count, uint32_t block, Result &result,
+                          Scan &&scan) {
+    if (!pool || count <= block) {
+        scan(first, count, result);
+        return;
+    }
+    const int block_count = (count + block - 1) / block;
+    std::vector<Result> partial(block_count);
+    pool->run(block_count, [&](int b, int) {
+        const uint32_t begin = first + b * block;
+        scan(begin, std::min(block, first + count - begin), partial[b]);
+    });
+    for (const Result &part : partial) {
+        result.merge(part);
+    }
+}
+
+struct RangeBounds {
+    AABB bounds;
+    AABB centroids;
+
+    void merge(const RangeBounds &other) {
+        bounds.grow(other.bounds);
+        centroids.grow(other.centroids);
+    }
+};
+
+const char *BVH::name() const {
+    switch (m_mode) {
+    case BVHBuildMode::Fast:
+        return "LBVH";
+    case BVHBuildMode::Treelet:
+        return "LBVH+treelets";
+    default:
+        return "BVH";
+    }
+}
+
+void BVH::build(TriangleStore &store, ThreadPool &pool) {
+    m_store = &store;
+    m_nodes.clear();
+    m_indices.resize(store.size());
+    std::iota(m_indices.begin(), m_indices.end(), 0);
+
+    const uint32_t count = store.size();
+    if (count == 0) {
+        return;
+    }
+
+    // Caixas e centróides são calculados uma única vez para toda a construção
+    BuildContext context{std::vector<AABB>(count), std::vector<Vector3>(count), m_indices, m_mode, {}};
+    pool.run((count + parallel_block - 1) / parallel_block, [&](int b, int) {
+        const uint32_t end = std::min(count, (b + 1) * parallel_block);
+        for (uint32_t i = b * parallel_block; i < end; i++) {
+            context.bounds[i] = store.bounds(i);
+            context.centroids[i] = context.bounds[i].center();
+        }
+    });
+    const bool linear = m_mode != BVHBuildMode::Quality;
+    if (linear) {
+        sort_morton(context, pool);
+    }
+
+    // Uma árvore binária com N folhas tem no máximo 2N - 1 nós
+    m_nodes.reserve(2 * count - 1);
+    m_nodes.emplace_back();
+    m_nodes[0].count = count;
+
+    // O topo da árvore é dividido em largura, nível a nível, com as varreduras de cada nó
+    // distribuídas no pool. Nós pequenos ficam para as subárvores. Na LBVH a divisão é uma
+    // busca binária nos códigos e as caixas do topo são calculadas no fim
+    std::vector<std::pair<uint32_t, int>> subtree_roots;
+    std::vector<std::pair<uint32_t, int>> level = {{0, 0}};
+    while (!level.empty()) {
+        std::vector<std::pair<uint32_t, int>> next_level;
+        for (const auto &[node_idx, depth] : level) {
+            if (m_nodes[node_idx].count < parallel_threshold) {
+                subtree_roots.emplace_back(node_idx, depth);
+            } else if (linear ? split_morton(context, m_nodes, node_idx, depth)
+                              : split(context, m_nodes, node_idx, depth, &pool)) {
+                const uint32_t left_idx = m_nodes[node_idx].left_first;
+                next_level.emplace_back(left_idx, depth + 1);
+                next_level.emplace_back(left_idx + 1, depth + 1);
+            }
+        }
+        level.swap(next_level);
+    }
+
+    // Cada subárvore é construída por uma thread em um vetor próprio, sobre um intervalo
+    // de índices que nenhuma outra toca
+    std::vector<std::vector<BVHNode>> subtrees(subtree_roots.size());
+    pool.run(subtree_roots.size(), [&](int i, int) {
+        std::vector<BVHNode> &nodes = subtrees[i];
+        nodes.reserve(2 * m_nodes[subtree_roots[i].first].count - 1);
+        nodes.push_back(m_nodes[subtree_roots[i].first]);
+        subdivide(context, nodes, 0, subtree_roots[i].second);
+        if (linear) {
+            refit(context, nodes);
+            if (m_mode == BVHBuildMode::Treelet) {
+                optimize_treelets(nodes);
+            }
+        }
+    });
+
+    // Junta as subárvores depois do topo. O nó j > 0 de uma subárvore vai para offset + j
+    // e a raiz substitui o nó do topo que a originou
+    const uint32_t top_count = m_nodes.size();
+    for (size_t i = 0; i < subtrees.size(); i++) {
+        const uint32_t offset = m_nodes.size() - 1;
+        for (size_t j = 1; j < subtrees[i].size(); j++) {
+            BVHNode node = subtrees[i][j];
+            if (!node.is_leaf()) {
+                node.left_first += offset;
+            }
+            m_nodes.push_back(node);
+        }
+        BVHNode root = subtrees[i][0];
+        if (!root.is_leaf()) {
+            root.left_first += offset;
+        }
+        m_nodes[subtree_roots[i].first] = root;
+    }
+    m_nodes.shrink_to_fit();
+
+    // Caixas do topo da LBVH. Os filhos sempre ficam depois do pai no vetor
+    if (linear) {
+        for (uint32_t i = top_count; i-- > 0;) {
+            BVHNode &node = m_nodes[i];
+            if (!node.is_leaf()) {
+                node.bounds = m_nodes[node.left_first].bounds;
+                node.bounds.grow(m_nodes[node.left_first + 1].bounds);
+            }
+        }
+    }
+
+    // Com os triângulos na ordem das folhas cada folha lê um intervalo contíguo
+    store.reorder(m_indices);
+    m_indices.clear();
+    m_indices.shrink_to_fit();
+}
+
+void BVH::adopt(const TriangleStore &store, std::vector<BVHNode> nodes) {
+    m_store = &store;
+    m_nodes = std::move(nodes);
+    m_indices.clear();
+}
+
+void BVH::subdivide(BuildContext &context, std::vector<BVHNode> &nodes, uint32_t node_idx, int depth) {
+    const bool divided = context.mode == BVHBuildMode::Quality ? split(context, nodes, node_idx, depth, nullptr)
+                                                                : split_morton(context, nodes, node_idx, depth);
+    if (!divided) {
+        return;
+    }
+    const uint32_t left_idx = nodes[node_idx].left_first;
+    subdivide(context, nodes, left_idx, depth + 1);
+    subdivide(context, nodes, left_idx + 1, depth + 1);
+}
+
+bool BVH::split(BuildContext &context, std::vector<BVHNode> &nodes, uint32_t node_idx, int depth,
+                ThreadPool *pool) {
+    const uint32_t first = nodes[node_idx].left_first;
+    const uint32_t count = nodes[node_idx].count;
+    const std::vector<AABB> &bounds = context.bounds;
+    const std::vector<Vector3> &centroids = context.centroids;
+    std::vector<uint32_t> &indices = context.indices;
+
+    RangeBounds range;
+    parallel_scan(pool, first, count, parallel_block, range, [&](uint32_t begin, uint32_t size, RangeBounds &out) {
+        for (uint32_t i = begin; i < begin + size; i++) {
+            out.bounds.grow(bounds[indices[i]]);
+            out.centroids.grow(centroids[indices[i]]);
+        }
+    });
+    const AABB &node_bounds = range.bounds;
+    const AABB &centroid_bounds = range.centroids;
+    nodes[node_idx].bounds = node_bounds;
+
+    if (count <= 1 || depth >= max_depth - 1) {
+        return false;
+    }
+
+    // Bins dos três eixos numa única passada, eixos sem extensão ficam vazios
+    float scale[3];
+    for (int axis = 0; axis < 3; axis++) {
+        const float axis_extent = centroid_bounds.max[axis] - centroid_bounds.min[axis];
+        scale[axis] = axis_extent > 0.0F ? bin_count / axis_extent : 0.0F;
+    }
+    Bins bins;
+    parallel_scan(pool, first, count, parallel_block, bins, [&](uint32_t begin, uint32_t size, Bins &out) {
+        for (uint32_t i = begin; i < begin + size; i++) {
+            const uint32_t idx = indices[i];
+            for (int axis = 0; axis < 3; axis++) {
+                if (scale[axis] == 0.0F) {
+                    continue;
+                }
+                const int bin = std::min(
+                    bin_count - 1, static_cast<int>((centroids[idx][axis] - centroid_bounds.min[axis]) * scale[axis]));
+                out.counts[axis][bin]++;
+                out.bounds[axis][bin].grow(bounds[idx]);
+            }
+        }
+    });
+
+    // Procura a melhor divisão avaliando o custo SAH nas fronteiras dos bins de cada eixo
+    float best_cost = INFINITY;
+    int best_axis = -1;
+    int best_split = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        if (scale[axis] == 0.0F) {
+            continue;
+        }
+
+        // Varre da direita para esquerda acumulando área e contagem
+        float right_area[bin_count - 1];
+        uint32_t right_count[bin_count - 1];
+        AABB right_box;
+        uint32_t right_sum = 0;
+        for (int i = bin_count - 1; i > 0; i--) {
+            right_box.grow(bins.bounds[axis][i]);
+            right_sum += bins.counts[axis][i];
+            right_area[i - 1] = right_box.surface_area();
+            right_count[i - 1] = right_sum;
+        }
+
+        AABB left_box;
+        uint32_t left_sum = 0;
+        for (int i = 0; i < bin_count - 1; i++) {
+            left_box.grow(bins.bounds[axis][i]);
+            left_sum += bins.counts[axis][i];
+            if (left_sum == 0 || right_count[i] == 0) {
+                continue;
+            }
+            const float cost = left_box.surface_area() * left_sum + right_area[i] * right_count[i];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = axis;
+                best_split = i;
+            }
+        }
+    }
+
+    // Todos os centróides coincidem, não há como dividir
+    if (best_axis == -1) {
+        return false;
+    }
+
+    // Custo de percorrer um nó interno considerado igual ao de testar um triângulo
+    const float split_cost = 1.0F + best_cost / node_bounds.surface_area();
+    const float leaf_cost = static_cast<float>(count);
+    if (split_cost >= leaf_cost && count <= max_leaf_size) {
+        return false;
+    }
+
+    const float axis_min = centroid_bounds.min[best_axis];
+    auto middle = std::partition(indices.begin() + first, indices.begin() + first + count, [&](uint32_t idx) {
+        const int bin =
+            std::min(bin_count - 1, static_cast<int>((centroids[idx][best_axis] - axis_min) * scale[best_axis]));
+        return bin <= best_split;
+    });
+    const uint32_t left_count = std::distance(indices.begin() + first, middle);
+
+    const uint32_t left_idx = nodes.size();
+    nodes.emplace_back();
+    nodes.emplace_back();
+    nodes[left_idx].left_first = first;
+    nodes[left_idx].count = left_count;
+    nodes[left_idx + 1].left_first = first + left_count;
+    nodes[left_idx + 1].count = count - left_count;
+    nodes[node_idx].left_first = left_idx;
+    nodes[node_idx].count = 0;
+    return true;
+}
+
+// Espalha os 10 bits menores de v deixando dois zeros entre cada bit
+static inline uint32_t expand_bits(uint32_t v) {
+    v = (v * 0x00010001U) & 0xFF0000FFU;
+    v = (v * 0x00000101U) & 0x0F00F00FU;
+    v = (v * 0x00000011U) & 0xC30C30C3U;
+    v = (v * 0x00000005U) & 0x49249249U;
+    return v;
+}
+
+// Ordenação radix LSD estável dos códigos, levando os índices junto, em quatro passadas de 8 bits.
+// Cada bloco conta os seus dígitos e depois espalha os seus elementos a partir da posição que os
+// blocos anteriores deixaram livre, então o resultado não depende do número de threads
+static void radix_sort(std::vector<uint32_t> &keys, std::vector<uint32_t> &values, uint32_t block,
+                       ThreadPool &pool) {
+    const uint32_t count = keys.size();
+    const int block_count = (count + block - 1) / block;
+    std::vector<uint32_t> keys_out(count);
+    std::vector<uint32_t> values_out(count);
+    std::vector<std::array<uint32_t, 256>> offsets(block_count);
+
+    for (int shift = 0; shift < 32; shift += 8) {
+        pool.run(block_count, [&](int b, int) {
+            offsets[b].fill(0);
+            const uint32_t end = std::min(count, (b + 1) * block);
+            for (uint32_t i = b * block; i < end; i++) {
+                offsets[b][(keys[i] >> shift) & 0xFF]++;
+            }
+        });
+
+        // Posição inicial de cada dígito em cada bloco, na ordem dígito e depois bloco
+        uint32_t sum = 0;
+        bool single_digit = false;
+        for (int digit = 0; digit < 256; digit++) {
+            const uint32_t digit_start = sum;
+            for (int b = 0; b < block_count; b++) {
+                const uint32_t digit_count = offsets[b][digit];
+                offsets[b][digit] = sum;
+                sum += digit_count;
+            }
+            single_digit = single_digit || sum - digit_start == count;
+        }
+        // Todos os códigos têm o mesmo dígito, a passada não muda a ordem
+        if (single_digit) {
+            continue;
+        }
+
+        pool.run(block_count, [&](int b, int) {
+            std::array<uint32_t, 256> &position = offsets[b];
+            const uint32_t end = std::min(count, (b + 1) * block);
+            for (uint32_t i = b * block; i < end; i++) {
+                const uint32_t target = position[(keys[i] >> shift) & 0xFF]++;
+                keys_out[target] = keys[i];
+                values_out[target] = values[i];
+            }
+        });
+        keys.swap(keys_out);
+        values.swap(values_out);
+    }
+}
+
+void BVH::sort_morton(BuildContext &context, ThreadPool &pool) {
+    const uint32_t count = context.indices.size();
+    RangeBounds range;
+    parallel_scan(&pool, 0, count, parallel_block, range, [&](uint32_t begin, uint32_t size, RangeBounds &out) {
+        for (uint32_t i = begin; i < begin + size; i++) {
+            out.centroids.grow(context.centroids[i]);
+        }
+    });
+
+    // Centróides quantizados em 10 bits por eixo dentro da caixa dos centróides
+    const AABB &centroid_bounds = range.centroids;
+    float scale[3];
+    for (int axis = 0; axis < 3; axis++) {
+        const float axis_extent = centroid_bounds.max[axis] - centroid_bounds.min[axis];
+        scale[axis] = axis_extent > 0.0F ? 1024.0F / axis_extent : 0.0F;
+    }
+    context.codes.resize(count);
+    pool.run((count + parallel_block - 1) / parallel_block, [&](int b, int) {
+        const uint32_t end = std::min(count, (b + 1) * parallel_block);
+        for (uint32_t i = b * parallel_block; i < end; i++) {
+            uint32_t cell[3];
+            for (int axis = 0; axis < 3; axis++) {
+                const float position = (context.centroids[i][axis] - centroid_bounds.min[axis]) * scale[axis];
+                cell[axis] = std::min(1023U, static_cast<uint32_t>(position));
+            }
+            context.codes[i] = (expand_bits(cell[0]) << 2) | (expand_bits(cell[1]) << 1) | expand_bits(cell[2]);
+        }
+    });
+
+    radix_sort(context.codes, context.indices, parallel_block, pool);
+}
+
+bool BVH::split_morton(BuildContext &context, std::vector<BVHNode> &nodes, uint32_t node_idx, int depth) {
+    const uint32_t first = nodes[node_idx].left_first;
+    const uint32_t count = nodes[node_idx].count;
+    if (count <= linear_leaf_size || depth >= max_depth - 1) {
+        return false;
+    }
+
+    // Os códigos do intervalo estão ordenados e compartilham os bits acima do primeiro bit em que
+    // o primeiro e o último diferem. A divisão fica no primeiro código com esse bit ligado.
+    // Códigos iguais não têm ordem espacial, o intervalo é dividido ao meio
+    const uint32_t *codes = context.codes.data();
+    const uint32_t first_code = codes[first];
+    const uint32_t last_code = codes[first + count - 1];
+    uint32_t left_count = count / 2;
+    if (first_code != last_code) {
+        const int bit = 31 - __builtin_clz(first_code ^ last_code);
+        const uint32_t split_code = ((first_code >> bit) | 1U) << bit;
+        left_count = std::lower_bound(codes + first, codes + first + count, split_code) - (codes + first);
+    }
+
+    const uint32_t left_idx = nodes.size();
+    nodes.emplace_back();
+    nodes.emplace_back();
+    nodes[left_idx].left_first = first;
+    nodes[left_idx].count = left_count;
+    nodes[left_idx + 1].left_first = first + left_count;
+    nodes[left_idx + 1].count = count - left_count;
+    nodes[node_idx].left_first = left_idx;
+    nodes[node_idx].count = 0;
+    return true;
+}
+
+void BVH::refit(const BuildContext &context, std::vector<BVHNode> &nodes) {
+    // Recém construída, a árvore tem os filhos sempre depois do pai
+    for (size_t i = nodes.size(); i-- > 0;) {
+        BVHNode &node = nodes[i];
+        node.bounds = AABB();
+        if (node.is_leaf()) {
+            for (uint32_t j = node.left_first; j < node.left_first + node.count; j++) {
+                node.bounds.grow(context.bounds[context.indices[j]]);
+            }
+        } else {
+            node.bounds.grow(nodes[node.left_first].bounds);
+            node.bounds.grow(nodes[node.left_first + 1].bounds);
+        }
+    }
+}
+
+// Reestruturação de treelets (Karras e Aila, 2013). A treelet de um nó é formada expandindo, a partir
+// dos seus dois filhos, a folha de maior área até ter treelet_size folhas. Uma programação dinâmica
+// sobre os subconjuntos das folhas encontra a topologia de menor custo SAH, que é escrita nas mesmas
+// posições do vetor: cada nó interno da treelet é dono de um par de posições consecutivas
+namespace {
+
+template <int Size>
+struct TreeletOptimizer {
+    static constexpr int subset_count = 1 << Size;
+
+    std::vector<BVHNode> &nodes;
+    std::vector<float> cost;      // Custo SAH de cada subárvore, sem normalizar pela raiz
+    std::vector<uint8_t> height;  // Altura de cada subárvore, a reestruturação nunca a aumenta
+
+    // Folhas da treelet e pares de posições dos seus nós internos
+    int leaf_count = 0;
+    uint32_t leaves[Size];
+    BVHNode leaf_nodes[Size];
+    uint32_t pairs[Size - 1];
+    int pair_count = 0;
+    // Caixa, custo, altura e melhor divisão de cada subconjunto de folhas
+    AABB subset_bounds[subset_count];
+    float subset_cost[subset_count];
+    uint8_t subset_height[subset_count];
+    uint32_t subset_split[subset_count];
+
+    explicit TreeletOptimizer(std::vector<BVHNode> &nodes)
+        : nodes(nodes), cost(nodes.size()), height(nodes.size()) {}
+
+    void set_internal_cost(uint32_t node_idx) {
+        const BVHNode &node = nodes[node_idx];
+        cost[node_idx] = node.bounds.surface_area() + cost[node.left_first] + cost[node.left_first + 1];
+        height[node_idx] = 1 + std::max(height[node.left_first], height[node.left_first + 1]);
+    }
+
+    // Pós-ordem, cada treelet é otimizada depois das subárvores abaixo dela
+    void optimize(uint32_t node_idx) {
+        const BVHNode &node = nodes[node_idx];
+        if (node.is_leaf()) {
+            cost[node_idx] = node.bounds.surface_area() * node.count;
+            height[node_idx] = 0;
+            return;
+        }
+        optimize(node.left_first);
+        optimize(node.left_first + 1);
+        set_internal_cost(node_idx);
+        restructure(node_idx);
+    }
+
+    void restructure(uint32_t root_idx) {
+        const uint32_t first_pair = nodes[root_idx].left_first;
+        leaves[0] = first_pair;
+        leaves[1] = first_pair + 1;
+        leaf_count = 2;
+        pairs[0] = first_pair;
+        pair_count = 1;
+        while (leaf_count < Size) {
+            int largest = -1;
+            float largest_area = -1.0F;
+            for (int i = 0; i < leaf_count; i++) {
+                const BVHNode &leaf = nodes[leaves[i]];
+                if (!leaf.is_leaf() && leaf.bounds.surface_area() > largest_area) {
+                    largest = i;
+                    largest_area = leaf.bounds.surface_area();
+                }
+            }
+            if (largest == -1) {
+                break;
+            }
+            const uint32_t children = nodes[leaves[largest]].left_first;
+            leaves[largest] = children;
+            leaves[leaf_count++] = children + 1;
+            pairs[pair_count++] = children;
+        }
+        // Com duas folhas só existe uma topologia
+        if (leaf_count < 3) {
+            return;
+        }
+
+        for (int i = 0; i < leaf_count; i++) {
+            leaf_nodes[i] = nodes[leaves[i]];
+            subset_bounds[1 << i] = leaf_nodes[i].bounds;
+            subset_cost[1 << i] = cost[leaves[i]];
+            subset_height[1 << i] = height[leaves[i]];
+        }
+
+        // Os subconjuntos de um conjunto são numericamente menores, a ordem crescente
+        // garante que ambos os lados de cada divisão já foram avaliados
+        const uint32_t full = (1U << leaf_count) - 1;
+        for (uint32_t subset = 3; subset <= full; subset++) {
+            const uint32_t lowest = subset & (0U - subset);
+            if (subset == lowest) {
+                continue;
+            }
+            subset_bounds[subset] = subset_bounds[subset ^ lowest];
+            subset_bounds[subset].grow(subset_bounds[lowest]);
+
+            // Cada divisão é avaliada uma vez, o lado esquerdo sempre contém a folha de menor índice
+            float best_cost = INFINITY;
+            uint32_t best_split = lowest;
+            const uint32_t others = subset ^ lowest;
+            for (uint32_t part = (others - 1) & others;; part = (part - 1) & others) {
+                const uint32_t left = part | lowest;
+                const float split_cost = subset_cost[left] + subset_cost[subset ^ left];
+                if (split_cost < best_cost) {
+                    best_cost = split_cost;
+                    best_split = left;
+                }
+                if (part == 0) {
+                    break;
+                }
+            }
+            subset_cost[subset] = subset_bounds[subset].surface_area() + best_cost;
+            subset_split[subset] = best_split;
+            subset_height[subset] =
+                1 + std::max(subset_height[best_split], subset_height[subset ^ best_split]);
+        }
+
+        // Mantém a topologia atual se não houver ganho ou se a árvore ficaria mais alta
+        // que a pilha de percurso permite
+        if (subset_cost[full] >= cost[root_idx] * 0.999F || subset_height[full] > height[root_idx]) {
+            return;
+        }
+        pair_count = 0;
+        emit(full, root_idx);
+    }
+
+    void emit(uint32_t subset, uint32_t node_idx) {
+        if ((subset & (subset - 1)) == 0) {
+            const int leaf = __builtin_ctz(subset);
+            nodes[node_idx] = leaf_nodes[leaf];
+            cost[node_idx] = subset_cost[subset];
+            height[node_idx] = subset_height[subset];
+            return;
+        }
+        const uint32_t pair = pairs[pair_count++];
+        BVHNode &node = nodes[node_idx];
+        node.bounds = subset_bounds[subset];
+        node.left_first = pair;
+        node.count = 0;
+        cost[node_idx] = subset_cost[subset];
+        height[node_idx] = subset_height[subset];
+        emit(subset_split[subset], pair);
+        emit(subset ^ subset_split[subset], pair + 1);
+    }
+};
+
+} // namespace
+
+void BVH::optimize_treelets(std::vector<BVHNode> &nodes) {
+    if (nodes.empty()) {
+        return;
+    }
+    // Os vetores da programação dinâmica ocupam alguns KB, ficam no heap
+    auto optimizer = std::make_unique<TreeletOptimizer<treelet_size>>(nodes);
+    optimizer->optimize(0);
+}
+
+float BVH::sah_cost() const {
+    if (m_nodes.empty() || m_nodes[0].bounds.surface_area() <= 0.0F) {
+        return 0.0F;
+    }
+    double cost = 0.0;
+    for (const BVHNode &node : m_nodes) {
+        cost += static_cast<double>(node.bounds.surface_area()) * (node.is_leaf() ? node.count : 1);
+    }
+    return cost / m_nodes[0].bounds.surface_area();
+}
+
+bool BVH::intersect(const Ray &ray, float &closest_t, int &closest_idx) const {
+    if (m_nodes.empty() || intersect_aabb(m_nodes[0].bounds, ray, closest_t) == INFINITY) {
+        return false;
+    }
+
+    const TriangleStore &store = *m_store;
+    RayCounters &counters = t_ray_counters;
+    const int start_idx = closest_idx;
+    uint32_t stack[max_depth];
+    int stack_size = 0;
+    uint32_t node_idx = 0;
+
+    while (true) {
+        const BVHNode &node = m_nodes[node_idx];
+        counters.node_visits++;
+
+        if (node.is_leaf()) {
+            counters.primitive_tests += node.count;
+            // Testa a folha em lotes de até 8 triângulos
+            for (uint32_t i = 0; i < node.count; i += 8) {
+                const BatchHit hit = intersect8(store, node.left_first + i, std::min(node.count - i, 8U), ray, closest_t);
+                // Em caso de empate mantém o menor índice, como na varredura linear
+                if (hit.index != -1 && (hit.t < closest_t || hit.index < closest_idx)) {
+                    closest_t = hit.t;
+                    closest_idx = hit.index;
+                }
+            }
+        } else {
+            // Visita primeiro o filho mais próximo, o outro fica na pilha
+            uint32_t near_idx = node.left_first;
+            uint32_t far_idx = node.left_first + 1;
+            float near_t = intersect_aabb(m_nodes[near_idx].bounds, ray, closest_t);
+            float far_t = intersect_aabb(m_nodes[far_idx].bounds, ray, closest_t);
+            if (far_t < near_t) {
+                std::swap(near_idx, far_idx);
+                std::swap(near_t, far_t);
+            }
+
+            if (near_t != INFINITY) {
+                if (far_t != INFINITY) {
+                    stack[stack_size++] = far_idx;
+                }
+                node_idx = near_idx;
+                continue;
+            }
+        }
+
+        // Desempilha descartando nós que ficaram atrás da interseção mais próxima
+        bool found = false;
+        while (stack_size > 0) {
+            node_idx = stack[--stack_size];
+            if (intersect_aabb(m_nodes[node_idx].bounds, ray, closest_t) != INFINITY) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            break;
+        }
+    }
+
+    return closest_idx != start_idx;
+}
+
+void BVH::intersect_packet(RayPacket &packet) const {
+    packet.finalize();
+    if (!packet.coherent) {
+        for (int i = 0; i < packet.size; i++) {
+            intersect(packet.rays[i], packet.t[i], packet.index[i]);
+        }
+        return;
+    }
+
+    // Maior distância entre as interseções dos raios, nós além dela não interessam a nenhum raio
+    float packet_t = INFINITY;
+    if (m_nodes.empty() || intersect_aabb_packet(m_nodes[0].bounds, packet, packet_t) == INFINITY) {
+        return;
+    }
+
+    const TriangleStore &store = *m_store;
+    RayCounters &counters = t_ray_counters;
+    uint32_t stack[max_depth];
+    int stack_size = 0;
+    uint32_t node_idx = 0;
+
+    while (true) {
+        const BVHNode &node = m_nodes[node_idx];
+        counters.node_visits++;
+
+        if (node.is_leaf()) {
+            packet_t = 0.0F;
+            for (int r = 0; r < packet.size; r++) {
+                const Ray &ray = packet.rays[r];
+                // Apenas os raios que atingem a folha testam seus triângulos
+                if (intersect_aabb(node.bounds, ray, packet.t[r]) != INFINITY) {
+                    counters.primitive_tests += node.count;
+                    for (uint32_t i = 0; i < node.count; i += 8) {
+                        const BatchHit hit =
+                            intersect8(store, node.left_first + i, std::min(node.count - i, 8U), ray, packet.t[r]);
+                        if (hit.index != -1 && (hit.t < packet.t[r] || hit.index < packet.index[r])) {
+                            packet.t[r] = hit.t;
+                            packet.index[r] = hit.index;
+                        }
+                    }
+                }
+                packet_t = std::max(packet_t, packet.t[r]);
+            }
+        } else {
+            uint32_t near_idx = node.left_first;
+            uint32_t far_idx = node.left_first + 1;
+            float near_t = intersect_aabb_packet(m_nodes[near_idx].bounds, packet, packet_t);
+            float far_t = intersect_aabb_packet(m_nodes[far_idx].bounds, packet, packet_t);
+            if (far_t < near_t) {
+                std::swap(near_idx, far_idx);
+                std::swap(near_t, far_t);
+            }
+
+            if (near_t != INFINITY) {
+                if (far_t != INFINITY) {
+                    stack[stack_size++] = far_idx;
+                }
+                node_idx = near_idx;
+                continue;
+            }
+        }
+
+        bool found = false;
+        while (stack_size > 0) {
+            node_idx = stack[--stack_size];
+            if (intersect_aabb_packet(m_nodes[node_idx].bounds, packet, packet_t) != INFINITY) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            break;
+        }
+    }
+}
+
+bool BVH::occluded(const Ray &ray, float t_max) const {
+    if (m_nodes.empty() || intersect_aabb(m_nodes[0].bounds, ray, t_max) == INFINITY) {
+        return false;
+    }
+
+    const TriangleStore &store = *m_store;
+    RayCounters &counters = t_ray_counters;
+    uint32_t stack[max_depth];
+    int stack_size = 0;
+    uint32_t node_idx = 0;
+
+    while (true) {
+        const BVHNode &node = m_nodes[node_idx];
+        counters.node_visits++;
+
+        if (node.is_leaf()) {
+            for (uint32_t i = 0; i < node.count; i += 8) {
+                counters.primitive_tests += std::min(node.count - i, 8U);
+                if (occluded8(store, node.left_first + i, std::min(node.count - i, 8U), ray, t_max)) {
+                    return true;
+                }
+            }
+        } else {
+            // Qualquer bloqueador serve, a ordem só importa para sair mais cedo
+            const uint32_t left_idx = node.left_first;
+            const uint32_t right_idx = node.left_first + 1;
+            const bool hit_left = intersect_aabb(m_nodes[left_idx].bounds, ray, t_max) != INFINITY;
+            const bool hit_right = intersect_aabb(m_nodes[right_idx].bounds, ray, t_max) != INFINITY;
+
+            if (hit_left || hit_right) {
+                if (hit_left && hit_right) {
+                    stack[stack_size++] = right_idx;
+                }
+                node_idx = hit_left ? left_idx : right_idx;
+                continue;
+            }
+        }
+
+        if (stack_size == 0) {
+            break;
+        }
+        node_idx = stack[--stack_size];
+    }
+
+    return false;
+}
@@ -0,0 +1,126 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "AABB.h"
+#include "Accelerator.h"
+
+// Nó da BVH, ocupa 32 bytes. Nós internos guardam o índice do filho esquerdo
+// (o direito é o seguinte no vetor) e folhas guardam o intervalo de primitivas
+struct BVHNode {
+    AABB bounds;
+    uint32_t left_first = 0; // Filho esquerdo (nó interno) ou primeira primitiva (folha)
+    uint32_t count = 0;      // Número de primitivas, 0 para nós internos
+
+    bool is_leaf() const { return count > 0; }
+};
+
+// Alarga a distância de saída das caixas para cobrir o arredondamento do teste de slab,
+// 1 + 2γ(3) com γ(n) = nε / (1 - nε) (Pharr, Jakob e Humphreys, PBRT 3ª ed., seção 3.9.2).
+// Sem ele um raio que passa rente à borda de uma caixa justa pode errar a caixa e
+// acertar o triângulo, abrindo buracos nas superfícies. O limite t_max também é alargado
+// para que caixas com um triângulo empatado na distância mais próxima sejam visitadas
+constexpr float slab_far_scale = 1.0F + 2.0F * (3.0F * 0x1p-24F) / (1.0F - 3.0F * 0x1p-24F);
+
+// Restringe [t_near, t_far] ao intervalo em que o raio está entre os dois planos de um eixo.
+// Os planos são escolhidos pelo sinal do inverso da direção e as comparações com NaN são falsas,
+// então um eixo com 0 * infinito (raio paralelo contido no plano de uma face) não restringe o intervalo
+inline void clip_slab(float min, float max, float origin, float inv_direction, float &t_near, float &t_far) {
+    const bool negative = std::signbit(inv_direction);
+    const float near_t = ((negative ? max : min) - origin) * inv_direction;
+    const float far_t = ((negative ? min : max) - origin) * inv_direction * slab_far_scale;
+    t_near = near_t > t_near ? near_t : t_near;
+    t_far = far_t < t_far ? far_t : t_far;
+}
+
+// Teste de slab entre raio e caixa, retorna a distância de entrada
+// ou INFINITY caso o raio não atinja a caixa antes de t_max
+inline float intersect_aabb(const AABB &box, const Ray &ray, float t_max) {
+    float t_near = 0.0F;
+    float t_far = t_max * slab_far_scale;
+    clip_slab(box.min.x, box.max.x, ray.origin.x, ray.inv_direction.x, t_near, t_far);
+    clip_slab(box.min.y, box.max.y, ray.origin.y, ray.inv_direction.y, t_near, t_far);
+    clip_slab(box.min.z, box.max.z, ray.origin.z, ray.inv_direction.z, t_near, t_far);
+    return t_near <= t_far ? t_near : INFINITY;
+}
+
+// Modos de construção da BVH, trocam qualidade da árvore por tempo de construção
+enum class BVHBuildMode {
+    Quality, // SAH em faixas, melhor árvore
+    Fast,    // LBVH: triângulos ordenados pela curva de Morton e divididos pelos bits do código
+    Treelet, // LBVH seguida da reestruturação de treelets, qualidade intermediária
+};
+
+// Bounding Volume Hierarchy construída com a heurística de área de superfície (SAH)
+// ou, nos modos rápidos, pela ordem dos centróides na curva de Morton
+class BVH : public Accelerator {
+  public:
+    const char *name() const override;
+
+    void set_build_mode(BVHBuildMode mode) { m_mode = mode; }
+    BVHBuildMode get_build_mode() const { return m_mode; }
+
+    // Constrói a hierarquia e reordena os triângulos na ordem das folhas. Os nós do topo são
+    // divididos em paralelo e as subárvores menores são construídas cada uma por uma thread
+    void build(TriangleStore &store, ThreadPool &pool) override;
+
+    // Custo SAH da árvore relativo à caixa da raiz, com nós internos e triângulos de custo 1.
+    // Menor é melhor, usado para comparar a qualidade de construções
+    float sah_cost() const;
+
+    bool intersect(const Ray &ray, float &closest_t, int &closest_idx) const override;
+
+    // Pacotes coerentes descartam nós em conjunto, pacotes divergentes
+    // são percorridos raio a raio
+    void intersect_packet(RayPacket &packet) const override;
+
+    bool occluded(const Ray &ray, float t_max) const override;
+
+    // Usa nós já construídos para um armazenamento que está na ordem das folhas,
+    // como os lidos do cache de cena
+    void adopt(const TriangleStore &store, std::vector<BVHNode> nodes);
+    const std::vector<BVHNode> &nodes() const { return m_nodes; }
+
+  private:
+    static constexpr int max_depth = 64;
+    static constexpr uint32_t max_leaf_size = 8;
+    static constexpr int bin_count = 16;
+    // Nós com pelo menos esta quantidade de triângulos são divididos com as varreduras
+    // distribuídas no pool, os menores viram subárvores construídas por uma única thread
+    static constexpr uint32_t parallel_threshold = 16384;
+    // Triângulos por tarefa nas varreduras paralelas
+    static constexpr uint32_t parallel_block = 4096;
+    // Folhas da LBVH, intervalos da curva de Morton com até esta quantidade viram folha
+    static constexpr uint32_t linear_leaf_size = 4;
+    // Folhas de cada treelet reorganizada, o custo da busca cresce com 3^n
+    static constexpr int treelet_size = 7;
+
+    struct BuildContext;
+    struct Bins;
+
+    BVHBuildMode m_mode = BVHBuildMode::Quality;
+    std::vector<BVHNode> m_nodes;
+    std::vector<uint32_t> m_indices; // Índices dos triângulos na ordem das folhas, usados na construção
+    const TriangleStore *m_store = nullptr;
+
+    // Divide o nó se a SAH compensar, criando os dois filhos no fim de nodes. Com pool as
+    // varreduras sobre os triângulos do nó são distribuídas entre as threads
+    static bool split(BuildContext &context, std::vector<BVHNode> &nodes, uint32_t node_idx, int depth,
+                      ThreadPool *pool);
+    static void subdivide(BuildContext &context, std::vector<BVHNode> &nodes, uint32_t node_idx, int depth);
+
+    // Construção rápida. sort_morton ordena os índices pelo código de Morton dos centróides,
+    // split_morton divide o nó no primeiro bit em que os códigos do intervalo diferem, sem calcular
+    // caixas, e refit calcula as caixas de baixo para cima depois que a topologia está pronta
+    static void sort_morton(BuildContext &context, ThreadPool &pool);
+    static bool split_morton(BuildContext &context, std::vector<BVHNode> &nodes, uint32_t node_idx, int depth);
+    static void refit(const BuildContext &context, std::vector<BVHNode> &nodes);
+    // Reorganiza as treelets de cada nó, de baixo para cima, na topologia de menor custo SAH
+    static void optimize_treelets(std::vector<BVHNode> &nodes);
+};
+
+#endif
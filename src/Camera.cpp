@@ -0,0 +1,65 @@
+#include "Camera.h"
+
+#include <immintrin.h>
+
+void Camera::update_ray_directions(int width, int height) {
+    if (m_directions_valid && width == m_directions_width && height == m_directions_height) {
+        return;
+    }
+
+    const size_t pixel_count = static_cast<size_t>(width) * height;
+    m_direction_x.resize(pixel_count);
+    m_direction_y.resize(pixel_count);
+    m_direction_z.resize(pixel_count);
+    m_directions_width = width;
+    m_directions_height = height;
+    m_directions_valid = true;
+
+    for (int y = 0; y < height; y++) {
+        const size_t row = static_cast<size_t>(y) * width;
+        int x = 0;
+
+#ifdef __AVX2__
+        // Mesma conta de get_ray_direction, sem FMA, para 8 pixels da linha por vez
+        const float scale = tan(m_fov * 0.5F * M_PI / 180.0F);
+        const float ndc_y = (1.0F - (2.0F * y / height)) * scale;
+        auto broadcast = [](float value) { return _mm256_set1_ps(value); };
+        const __m256 up_x = broadcast(m_up.x * ndc_y);
+        const __m256 up_y = broadcast(m_up.y * ndc_y);
+        const __m256 up_z = broadcast(m_up.z * ndc_y);
+
+        for (; x + 8 <= width; x += 8) {
+            const __m256 screen_x = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(x),
+                                                                       _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+            const __m256 ndc_x = _mm256_mul_ps(
+                _mm256_mul_ps(_mm256_sub_ps(_mm256_div_ps(_mm256_mul_ps(broadcast(2.0F), screen_x),
+                                                          broadcast(static_cast<float>(width))),
+                                            broadcast(1.0F)),
+                              broadcast(m_aspect_ratio)),
+                broadcast(scale));
+
+            const __m256 dx =
+                _mm256_add_ps(_mm256_add_ps(broadcast(m_forward.x), _mm256_mul_ps(broadcast(m_right.x), ndc_x)), up_x);
+            const __m256 dy =
+                _mm256_add_ps(_mm256_add_ps(broadcast(m_forward.y), _mm256_mul_ps(broadcast(m_right.y), ndc_x)), up_y);
+            const __m256 dz =
+                _mm256_add_ps(_mm256_add_ps(broadcast(m_forward.z), _mm256_mul_ps(broadcast(m_right.z), ndc_x)), up_z);
+
+            // Normaliza, forward é unitário e ortogonal aos demais então o comprimento nunca é 0
+            const __m256 length = _mm256_sqrt_ps(
+                _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)));
+            _mm256_storeu_ps(m_direction_x.data() + row + x, _mm256_div_ps(dx, length));
+            _mm256_storeu_ps(m_direction_y.data() + row + x, _mm256_div_ps(dy, length));
+            _mm256_storeu_ps(m_direction_z.data() + row + x, _mm256_div_ps(dz, length));
+        }
+#endif
+
+        // Restante da linha, ou a linha inteira sem AVX2
+        for (; x < width; x++) {
+            const Vector3 direction = get_ray_direction(x, y, width, height);
+            m_direction_x[row + x] = direction.x;
+            m_direction_y[row + x] = direction.y;
+            m_direction_z[row + x] = direction.z;
+        }
+    }
+}
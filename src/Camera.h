@@ -1,9 +1,20 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
 #include <algorithm>
 #include <cmath>
 #include <iostream>
+#include <vector>
 
 #include "Vector3.h"
 
+// Orientação e posição da câmera, sem a tabela de direções nem a proporção da janela.
+// Gravada no cache de cena
+struct CameraPose {
+    Vector3 position, forward, right, up;
+    float fov, yaw, pitch;
+};
+
 class Camera {
 
   public:
@@ -34,8 +45,10 @@ class Camera {
 
         m_right = Vector3(0, 1, 0).cross(m_forward).normalized();
         m_up = m_forward.cross(m_right).normalized();
+        m_directions_valid = false;
     }
 
+    // A translação não altera as direções dos raios, a tabela continua válida
     void move(float dx, float dy, float dz) {
         // Movimento da câmera em relação a seus vetores
         m_position = m_position + m_right * dx + m_up * dy + m_forward * dz;
@@ -57,8 +70,35 @@ class Camera {
         return (m_forward + m_right * ndc_x + m_up * ndc_y).normalized();
     }
 
+    // Prepara a tabela de direções para a resolução dada. Só recalcula após
+    // rotação, mudança de proporção ou de resolução
+    void update_ray_directions(int width, int height);
+
+    // Direção do raio primário do pixel, lida da tabela preparada por update_ray_directions
+    Vector3 ray_direction(int screen_x, int screen_y) const {
+        const size_t i = static_cast<size_t>(screen_y) * m_directions_width + screen_x;
+        return {m_direction_x[i], m_direction_y[i], m_direction_z[i]};
+    }
+
     const Vector3& get_position() { return m_position; }
-    void set_aspect_ratio(float aspect_ratio) { m_aspect_ratio = aspect_ratio; }
+
+    CameraPose get_pose() const { return {m_position, m_forward, m_right, m_up, m_fov, m_yaw, m_pitch}; }
+    void set_pose(const CameraPose &pose) {
+        m_position = pose.position;
+        m_forward = pose.forward;
+        m_right = pose.right;
+        m_up = pose.up;
+        m_fov = pose.fov;
+        m_yaw = pose.yaw;
+        m_pitch = pose.pitch;
+        m_directions_valid = false;
+    }
+    void set_aspect_ratio(float aspect_ratio) {
+        if (aspect_ratio != m_aspect_ratio) {
+            m_aspect_ratio = aspect_ratio;
+            m_directions_valid = false;
+        }
+    }
 
   private:
     Vector3 m_position = {0, 0, 0};
@@ -70,4 +110,14 @@ class Camera {
 
     float m_yaw = -M_PI / 2.0;
     float m_pitch = 0.0;
+
+    // Tabela de direções por pixel, em SoA para ser preenchida com SIMD
+    std::vector<float> m_direction_x;
+    std::vector<float> m_direction_y;
+    std::vector<float> m_direction_z;
+    int m_directions_width = 0;
+    int m_directions_height = 0;
+    bool m_directions_valid = false;
 };
+
+#endif
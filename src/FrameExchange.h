@@ -0,0 +1,48 @@
+#ifndef FRAME_EXCHANGE_H
+#define FRAME_EXCHANGE_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Imagem pronta para apresentação
+struct Frame {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels; // RGB, linha de baixo primeiro como espera o glDrawPixels
+    char overlay[512] = {};      // Texto sobreposto à imagem, vazio sem a sobreposição de métricas
+};
+
+// Buffer triplo sem trava entre a thread que renderiza e a que apresenta. O produtor
+// escreve no quadro de trás e o publica trocando-o atomicamente pelo quadro pronto,
+// o consumidor troca o seu pelo pronto quando há um novo. Nenhum lado espera o outro
+// e o consumidor sempre apresenta o quadro mais recente
+class FrameExchange {
+  public:
+    // Quadro de trás, usado apenas pelo produtor
+    Frame &back() { return m_frames[m_back]; }
+
+    void publish() { m_back = m_ready.exchange(m_back | fresh_bit, std::memory_order_acq_rel) & index_mask; }
+
+    // Indica se há um quadro publicado ainda não apresentado
+    bool fresh() const { return m_ready.load(std::memory_order_acquire) & fresh_bit; }
+
+    // Quadro da frente, passa a ser o mais recente publicado. Usado apenas pelo consumidor
+    const Frame &front() {
+        if (fresh()) {
+            m_front = m_ready.exchange(m_front, std::memory_order_acq_rel) & index_mask;
+        }
+        return m_frames[m_front];
+    }
+
+  private:
+    static constexpr int index_mask = 3;
+    static constexpr int fresh_bit = 4;
+
+    Frame m_frames[3];
+    int m_back = 0;
+    std::atomic<int> m_ready{1}; // Índice do quadro pronto e o bit de novo
+    int m_front = 2;
+};
+
+#endif
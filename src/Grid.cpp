@@ -0,0 +1,216 @@
+#include "Grid.h"
+#include "Stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Mailbox do raio com endereçamento direto pelo índice do triângulo. Evita testar de novo
+// um triângulo que ocupa várias células sem exigir memória por triângulo ou por thread,
+// uma colisão apenas faz o triângulo ser testado outra vez
+struct Mailbox {
+    static constexpr uint32_t size = 32;
+    uint32_t entries[size];
+
+    Mailbox() { std::fill(entries, entries + size, UINT32_MAX); }
+
+    // Retorna true se o triângulo já foi testado por este raio
+    bool visited(uint32_t triangle) {
+        uint32_t &slot = entries[triangle & (size - 1)];
+        if (slot == triangle) {
+            return true;
+        }
+        slot = triangle;
+        return false;
+    }
+};
+
+int UniformGrid::cell_coord(float value, int axis) const {
+    const int coord = static_cast<int>((value - m_bounds.min[axis]) * m_inv_cell_size[axis]);
+    return std::clamp(coord, 0, m_resolution[axis] - 1);
+}
+
+void UniformGrid::build(TriangleStore &store, ThreadPool & /*pool*/) {
+    m_store = &store;
+    m_bounds = AABB();
+    m_cell_start.clear();
+    m_cell_triangles.clear();
+
+    const uint32_t count = store.size();
+    if (count == 0) {
+        return;
+    }
+
+    std::vector<AABB> bounds(count);
+    for (uint32_t i = 0; i < count; i++) {
+        bounds[i] = store.bounds(i);
+        m_bounds.grow(bounds[i]);
+    }
+
+    // Uma pequena margem evita dimensões nulas em cenas planas
+    const Vector3 scene_extent = m_bounds.extent();
+    const float margin = std::max(std::max({scene_extent.x, scene_extent.y, scene_extent.z}) * 1e-3F, 1e-6F);
+    m_bounds.min = m_bounds.min - Vector3(margin, margin, margin);
+    m_bounds.max = m_bounds.max + Vector3(margin, margin, margin);
+
+    // Resolução proporcional à raiz cúbica da densidade de triângulos por volume
+    const Vector3 extent = m_bounds.extent();
+    const float cells_per_unit = std::cbrt(density * count / (extent.x * extent.y * extent.z));
+    for (int axis = 0; axis < 3; axis++) {
+        m_resolution[axis] = std::clamp(static_cast<int>(std::ceil(extent[axis] * cells_per_unit)), 1, max_resolution);
+        m_cell_size[axis] = extent[axis] / m_resolution[axis];
+        m_inv_cell_size[axis] = m_resolution[axis] / extent[axis];
+    }
+
+    // Percorre as células tocadas pela caixa de cada triângulo
+    auto for_each_cell = [&](const AABB &box, auto &&fn) {
+        const int x0 = cell_coord(box.min.x, 0), x1 = cell_coord(box.max.x, 0);
+        const int y0 = cell_coord(box.min.y, 1), y1 = cell_coord(box.max.y, 1);
+        const int z0 = cell_coord(box.min.z, 2), z1 = cell_coord(box.max.z, 2);
+        for (int z = z0; z <= z1; z++) {
+            for (int y = y0; y <= y1; y++) {
+                for (int x = x0; x <= x1; x++) {
+                    fn((z * m_resolution[1] + y) * m_resolution[0] + x);
+                }
+            }
+        }
+    };
+
+    // Primeira passada conta os triângulos de cada célula, a segunda preenche as listas
+    const size_t cell_count = static_cast<size_t>(m_resolution[0]) * m_resolution[1] * m_resolution[2];
+    m_cell_start.assign(cell_count + 1, 0);
+    for (uint32_t i = 0; i < count; i++) {
+        for_each_cell(bounds[i], [&](size_t cell) { m_cell_start[cell + 1]++; });
+    }
+    for (size_t cell = 0; cell < cell_count; cell++) {
+        m_cell_start[cell + 1] += m_cell_start[cell];
+    }
+
+    m_cell_triangles.resize(m_cell_start[cell_count]);
+    std::vector<uint32_t> fill(m_cell_start.begin(), m_cell_start.end() - 1);
+    for (uint32_t i = 0; i < count; i++) {
+        for_each_cell(bounds[i], [&](size_t cell) { m_cell_triangles[fill[cell]++] = i; });
+    }
+}
+
+template <typename Visitor>
+void UniformGrid::traverse(const Ray &ray, float t_max, Visitor &&visit) const {
+    if (m_cell_start.empty()) {
+        return;
+    }
+
+    // Recorta o raio na caixa da grade
+    float t_enter = 0.0F;
+    float t_exit = t_max;
+    for (int axis = 0; axis < 3; axis++) {
+        const float t1 = (m_bounds.min[axis] - ray.origin[axis]) * ray.inv_direction[axis];
+        const float t2 = (m_bounds.max[axis] - ray.origin[axis]) * ray.inv_direction[axis];
+        t_enter = std::max(t_enter, std::min(t1, t2));
+        t_exit = std::min(t_exit, std::max(t1, t2));
+    }
+    if (t_enter > t_exit) {
+        return;
+    }
+
+    // Célula inicial, distância até a próxima fronteira e passo em cada eixo
+    const Vector3 entry = ray.origin + ray.direction * t_enter;
+    int cell[3];
+    int step[3];
+    float t_next[3];
+    float t_delta[3];
+    for (int axis = 0; axis < 3; axis++) {
+        cell[axis] = cell_coord(entry[axis], axis);
+        if (ray.direction[axis] > 0.0F) {
+            step[axis] = 1;
+            t_next[axis] = (m_bounds.min[axis] + (cell[axis] + 1) * m_cell_size[axis] - ray.origin[axis]) *
+                           ray.inv_direction[axis];
+            t_delta[axis] = m_cell_size[axis] * ray.inv_direction[axis];
+        } else if (ray.direction[axis] < 0.0F) {
+            step[axis] = -1;
+            t_next[axis] =
+                (m_bounds.min[axis] + cell[axis] * m_cell_size[axis] - ray.origin[axis]) * ray.inv_direction[axis];
+            t_delta[axis] = -m_cell_size[axis] * ray.inv_direction[axis];
+        } else {
+            step[axis] = 0;
+            t_next[axis] = INFINITY;
+            t_delta[axis] = INFINITY;
+        }
+    }
+
+    while (true) {
+        int axis = 0;
+        if (t_next[1] < t_next[axis]) {
+            axis = 1;
+        }
+        if (t_next[2] < t_next[axis]) {
+            axis = 2;
+        }
+
+        const size_t idx = (static_cast<size_t>(cell[2]) * m_resolution[1] + cell[1]) * m_resolution[0] + cell[0];
+        if (visit(m_cell_start[idx], m_cell_start[idx + 1], std::min(t_next[axis], t_exit))) {
+            return;
+        }
+
+        if (t_next[axis] > t_exit) {
+            return;
+        }
+        cell[axis] += step[axis];
+        if (cell[axis] < 0 || cell[axis] >= m_resolution[axis]) {
+            return;
+        }
+        t_next[axis] += t_delta[axis];
+    }
+}
+
+bool UniformGrid::intersect(const Ray &ray, float &closest_t, int &closest_idx) const {
+    const TriangleStore &store = *m_store;
+    RayCounters &counters = t_ray_counters;
+    const int start_idx = closest_idx;
+    Mailbox mailbox;
+
+    traverse(ray, closest_t, [&](uint32_t first, uint32_t last, float cell_exit) {
+        counters.node_visits++;
+        for (uint32_t i = first; i < last; i++) {
+            const uint32_t triangle = m_cell_triangles[i];
+            if (mailbox.visited(triangle)) {
+                continue;
+            }
+            counters.primitive_tests++;
+            const float t = store.intersect(triangle, ray);
+            const int idx = static_cast<int>(triangle);
+            // Em caso de empate mantém o menor índice, como na BVH
+            if (t < closest_t || (t == closest_t && idx < closest_idx)) {
+                closest_t = t;
+                closest_idx = idx;
+            }
+        }
+        // Uma interseção além da saída da célula ainda pode ser superada nas células seguintes
+        return closest_t <= cell_exit;
+    });
+
+    return closest_idx != start_idx;
+}
+
+bool UniformGrid::occluded(const Ray &ray, float t_max) const {
+    const TriangleStore &store = *m_store;
+    RayCounters &counters = t_ray_counters;
+    Mailbox mailbox;
+    bool hit = false;
+
+    traverse(ray, t_max, [&](uint32_t first, uint32_t last, float /*cell_exit*/) {
+        counters.node_visits++;
+        for (uint32_t i = first; i < last; i++) {
+            const uint32_t triangle = m_cell_triangles[i];
+            if (mailbox.visited(triangle)) {
+                continue;
+            }
+            counters.primitive_tests++;
+            if (store.intersect(triangle, ray) < t_max) {
+                hit = true;
+                break;
+            }
+        }
+        return hit;
+    });
+
+    return hit;
+}
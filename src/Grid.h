@@ -0,0 +1,41 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <cstdint>
+#include <vector>
+
+#include "AABB.h"
+#include "Accelerator.h"
+
+// Grade uniforme de voxels sobre a cena, percorrida com 3D-DDA (Amanatides & Woo).
+// Cada célula guarda os triângulos cujas caixas a tocam, em formato compacto (CSR)
+class UniformGrid : public Accelerator {
+  public:
+    const char *name() const override { return "grid"; }
+
+    void build(TriangleStore &store, ThreadPool &pool) override;
+    bool intersect(const Ray &ray, float &closest_t, int &closest_idx) const override;
+    bool occluded(const Ray &ray, float t_max) const override;
+
+  private:
+    // Células por triângulo usadas para escolher a resolução
+    static constexpr float density = 2.0F;
+    static constexpr int max_resolution = 512;
+
+    AABB m_bounds;
+    int m_resolution[3] = {0, 0, 0};
+    Vector3 m_cell_size;
+    Vector3 m_inv_cell_size;
+    std::vector<uint32_t> m_cell_start; // Início da lista de cada célula em m_cell_triangles
+    std::vector<uint32_t> m_cell_triangles;
+    const TriangleStore *m_store = nullptr;
+
+    int cell_coord(float value, int axis) const;
+
+    // Percorre as células atingidas pelo raio entre 0 e t_max chamando visit(primeiro, último, t_saída)
+    // para cada uma, até que visit retorne true
+    template <typename Visitor>
+    void traverse(const Ray &ray, float t_max, Visitor &&visit) const;
+};
+
+#endif
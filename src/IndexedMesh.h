@@ -0,0 +1,57 @@
+#ifndef INDEXED_MESH_H
+#define INDEXED_MESH_H
+
+#include <cstdint>
+#include <vector>
+
+#include "AABB.h"
+#include "Vector3.h"
+
+// Geometria da cena na forma indexada: vértices compartilhados entre os triângulos,
+// três índices de 32 bits por triângulo e o índice de material de cada triângulo.
+// É a forma em que a cena é montada e gravada no cache. A construção deriva dela o
+// empacotamento usado na interseção e então a libera, só o empacotamento fica residente
+struct IndexedMesh {
+    std::vector<Vector3> vertices;
+    std::vector<uint32_t> indices;  // Três por triângulo
+    std::vector<uint32_t> material; // Um por triângulo, índice na tabela de materiais
+
+    size_t triangle_count() const { return material.size(); }
+
+    Vector3 vertex(size_t triangle, int corner) const { return vertices[indices[3 * triangle + corner]]; }
+
+    void clear() {
+        vertices.clear();
+        indices.clear();
+        material.clear();
+    }
+
+    // Acrescenta um triângulo com vértices próprios
+    void add_triangle(const Vector3 &v0, const Vector3 &v1, const Vector3 &v2, uint32_t material_idx) {
+        const uint32_t first = vertices.size();
+        vertices.insert(vertices.end(), {v0, v1, v2});
+        indices.insert(indices.end(), {first, first + 1, first + 2});
+        material.push_back(material_idx);
+    }
+
+    // Acrescenta outra malha, deslocando os seus índices para depois dos vértices atuais
+    void append(const IndexedMesh &other) {
+        const uint32_t offset = vertices.size();
+        vertices.insert(vertices.end(), other.vertices.begin(), other.vertices.end());
+        indices.reserve(indices.size() + other.indices.size());
+        for (uint32_t index : other.indices) {
+            indices.push_back(index + offset);
+        }
+        material.insert(material.end(), other.material.begin(), other.material.end());
+    }
+
+    AABB bounds() const {
+        AABB box;
+        for (uint32_t index : indices) {
+            box.grow(vertices[index]);
+        }
+        return box;
+    }
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include "LightTree.h"
+
+#include <algorithm>
+#include <cmath>
+
+void LightTree::build(const std::vector<Vector3> &positions, const std::vector<float> &radii) {
+    m_nodes.clear();
+    m_indices.clear();
+    m_unbounded.clear();
+
+    for (uint32_t i = 0; i < positions.size(); i++) {
+        if (std::isinf(radii[i])) {
+            m_unbounded.push_back(i);
+        } else if (radii[i] > 0.0F) {
+            // Luzes de alcance nulo (cor preta) nunca contribuem
+            m_indices.push_back(i);
+        }
+    }
+
+    if (!m_indices.empty()) {
+        m_nodes.reserve(2 * m_indices.size() - 1);
+        m_nodes.emplace_back();
+        m_nodes[0].count = m_indices.size();
+        subdivide(0, 0, positions, radii);
+    }
+
+    // Posições e raios copiados na ordem das folhas para a consulta ler em sequência
+    m_positions.resize(m_indices.size());
+    m_radii_squared.resize(m_indices.size());
+    for (size_t i = 0; i < m_indices.size(); i++) {
+        m_positions[i] = positions[m_indices[i]];
+        m_radii_squared[i] = radii[m_indices[i]] * radii[m_indices[i]];
+    }
+}
+
+void LightTree::subdivide(uint32_t node_idx, int depth, const std::vector<Vector3> &positions,
+                          const std::vector<float> &radii) {
+    const uint32_t first = m_nodes[node_idx].left_first;
+    const uint32_t count = m_nodes[node_idx].count;
+
+    AABB bounds;
+    AABB centroid_bounds;
+    for (uint32_t i = first; i < first + count; i++) {
+        const Vector3 &pos = positions[m_indices[i]];
+        const float radius = radii[m_indices[i]];
+        bounds.grow(pos - Vector3(radius, radius, radius));
+        bounds.grow(pos + Vector3(radius, radius, radius));
+        centroid_bounds.grow(pos);
+    }
+    m_nodes[node_idx].bounds = bounds;
+
+    if (count <= max_leaf_size || depth >= max_depth - 1) {
+        return;
+    }
+
+    // Divide pela mediana no eixo de maior extensão das posições, deixando
+    // metade das luzes de cada lado
+    const int axis = centroid_bounds.largest_axis();
+    const uint32_t mid = first + count / 2;
+    std::nth_element(m_indices.begin() + first, m_indices.begin() + mid, m_indices.begin() + first + count,
+                     [&](uint32_t a, uint32_t b) { return positions[a][axis] < positions[b][axis]; });
+
+    const uint32_t left = m_nodes.size();
+    m_nodes.emplace_back();
+    m_nodes.emplace_back();
+    m_nodes[left].left_first = first;
+    m_nodes[left].count = mid - first;
+    m_nodes[left + 1].left_first = mid;
+    m_nodes[left + 1].count = first + count - mid;
+    m_nodes[node_idx].left_first = left;
+    m_nodes[node_idx].count = 0;
+
+    subdivide(left, depth + 1, positions, radii);
+    subdivide(left + 1, depth + 1, positions, radii);
+}
@@ -0,0 +1,85 @@
+#ifndef LIGHT_TREE_H
+#define LIGHT_TREE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "AABB.h"
+
+// Nó da hierarquia de luzes, guarda a caixa que envolve as esferas de alcance
+// das luzes abaixo dele. Mesmo layout dos nós da BVH de triângulos
+struct LightNode {
+    AABB bounds;
+    uint32_t left_first = 0; // Filho esquerdo (nó interno) ou primeira luz (folha)
+    uint32_t count = 0;      // Número de luzes, 0 para nós internos
+
+    bool is_leaf() const { return count > 0; }
+};
+
+// Hierarquia de esferas de alcance das luzes. Cada luz contribui apenas dentro
+// do raio efetivo em que sua intensidade atenuada fica acima do limiar de corte,
+// então um ponto só precisa avaliar as luzes cujas esferas o contêm
+class LightTree {
+  public:
+    // Raios infinitos marcam luzes sem atenuação, sempre avaliadas
+    void build(const std::vector<Vector3> &positions, const std::vector<float> &radii);
+
+    // Chama visit(índice) para cada luz que alcança o ponto, sem alocação
+    template <typename Visit> void query(const Vector3 &point, Visit &&visit) const {
+        for (const uint32_t light : m_unbounded) {
+            visit(light);
+        }
+        if (m_nodes.empty()) {
+            return;
+        }
+
+        uint32_t stack[max_depth];
+        int stack_size = 0;
+        uint32_t node_idx = 0;
+        while (true) {
+            const LightNode &node = m_nodes[node_idx];
+            if (contains(node.bounds, point)) {
+                if (node.is_leaf()) {
+                    for (uint32_t i = node.left_first; i < node.left_first + node.count; i++) {
+                        const Vector3 offset = point - m_positions[i];
+                        if (offset.dot(offset) <= m_radii_squared[i]) {
+                            visit(m_indices[i]);
+                        }
+                    }
+                } else {
+                    stack[stack_size++] = node.left_first + 1;
+                    node_idx = node.left_first;
+                    continue;
+                }
+            }
+            if (stack_size == 0) {
+                break;
+            }
+            node_idx = stack[--stack_size];
+        }
+    }
+
+    size_t bounded_count() const { return m_indices.size(); }
+    size_t unbounded_count() const { return m_unbounded.size(); }
+
+  private:
+    static constexpr int max_depth = 64;
+    static constexpr uint32_t max_leaf_size = 4;
+
+    std::vector<LightNode> m_nodes;
+    // Luzes com alcance finito na ordem das folhas
+    std::vector<uint32_t> m_indices;
+    std::vector<Vector3> m_positions;
+    std::vector<float> m_radii_squared;
+    std::vector<uint32_t> m_unbounded;
+
+    static bool contains(const AABB &box, const Vector3 &point) {
+        return point.x >= box.min.x && point.x <= box.max.x && point.y >= box.min.y && point.y <= box.max.y &&
+               point.z >= box.min.z && point.z <= box.max.z;
+    }
+
+    void subdivide(uint32_t node_idx, int depth, const std::vector<Vector3> &positions,
+                   const std::vector<float> &radii);
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Arquivo mapeado somente para leitura, desfeito na destruição.
+// data() é nulo se o arquivo não existe, está vazio ou não pôde ser mapeado
+class MappedFile {
+  public:
+    explicit MappedFile(const char *path) {
+        const int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void *data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                m_data = static_cast<const uint8_t *>(data);
+                m_size = info.st_size;
+                madvise(data, m_size, MADV_SEQUENTIAL);
+            }
+        }
+        close(fd);
+    }
+    ~MappedFile() {
+        if (m_data) {
+            munmap(const_cast<uint8_t *>(m_data), m_size);
+        }
+    }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const uint8_t *data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+  private:
+    const uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+static const char *const stage_names[stage_count] = {"ray_generation", "primary", "shadow", "shading", "present"};
+
+void MetricsRing::push(const FrameMetrics &frame) {
+    const uint64_t index = m_count.load(std::memory_order_relaxed);
+    Slot &slot = m_slots[index % capacity];
+
+    const uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.frame = frame;
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+
+    m_count.store(index + 1, std::memory_order_release);
+}
+
+size_t MetricsRing::snapshot(FrameMetrics *out) const {
+    const uint64_t count = m_count.load(std::memory_order_acquire);
+    const uint64_t first = count > capacity ? count - capacity : 0;
+
+    size_t copied = 0;
+    for (uint64_t i = first; i < count; i++) {
+        const Slot &slot = m_slots[i % capacity];
+        const uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+        out[copied] = slot.frame;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == before) {
+            copied++;
+        }
+    }
+    return copied;
+}
+
+void Metrics::record(double frame_ms, uint64_t frame_cycles, uint64_t frame_ns, const RayCounters &counters) {
+    m_total_cycles += frame_cycles;
+    m_total_ns += frame_ns;
+    const double ms_per_cycle = m_total_cycles > 0 ? m_total_ns / 1e6 / m_total_cycles : 0.0;
+
+    FrameMetrics frame;
+    frame.frame = m_frame++;
+    frame.frame_ms = frame_ms;
+    frame.counters = counters;
+    for (int i = 0; i < stage_count; i++) {
+        frame.stage_ms[i] = counters.stage_cycles[i] * ms_per_cycle;
+    }
+    frame.stage_ms[static_cast<int>(Stage::Present)] = m_present_ns.load(std::memory_order_relaxed) / 1e6;
+
+    m_last = frame;
+    m_ring.push(frame);
+}
+
+MetricsSummary Metrics::summarize() const {
+    FrameMetrics frames[MetricsRing::capacity];
+    double values[MetricsRing::capacity];
+
+    MetricsSummary summary;
+    summary.frames = m_ring.snapshot(frames);
+    if (summary.frames == 0) {
+        return summary;
+    }
+
+    // Percentil pelo posto mais próximo
+    auto percentiles = [&](double *result) {
+        std::sort(values, values + summary.frames);
+        for (int p = 0; p < MetricsSummary::percentile_count; p++) {
+            const size_t rank = static_cast<size_t>(MetricsSummary::percentiles[p] * (summary.frames - 1) + 0.5);
+            result[p] = values[rank];
+        }
+    };
+
+    for (size_t i = 0; i < summary.frames; i++) {
+        values[i] = frames[i].frame_ms;
+    }
+    percentiles(summary.frame_ms);
+    for (int stage = 0; stage < stage_count; stage++) {
+        for (size_t i = 0; i < summary.frames; i++) {
+            values[i] = frames[i].stage_ms[stage];
+        }
+        percentiles(summary.stage_ms[stage]);
+    }
+    return summary;
+}
+
+void Metrics::format_overlay(char *out, size_t size) const {
+    const MetricsSummary summary = summarize();
+    const RayCounters &counters = m_last.counters;
+    const double occluded =
+        counters.shadow_rays > 0 ? 100.0 * counters.shadow_occluded / counters.shadow_rays : 0.0;
+    auto p50 = [&](Stage stage) { return summary.stage_ms[static_cast<int>(stage)][0]; };
+
+    std::snprintf(out, size,
+                  "quadro %.2fms  p50 %.2f  p95 %.2f  p99 %.2f (%zu quadros)\n"
+                  "p50: geracao %.2f  primaria %.2f  sombra %.2f  sombreamento %.2f  apresentacao %.2f ms\n"
+                  "raios %.2fM  primitivas %.2fM  nos %.2fM  sombras bloqueadas %.0f%%",
+                  m_last.frame_ms, summary.frame_ms[0], summary.frame_ms[1], summary.frame_ms[2], summary.frames,
+                  p50(Stage::RayGeneration), p50(Stage::Primary), p50(Stage::Shadow), p50(Stage::Shading),
+                  p50(Stage::Present), (counters.primary_rays + counters.shadow_rays) / 1e6,
+                  counters.primitive_tests / 1e6, counters.node_visits / 1e6, occluded);
+}
+
+bool Metrics::write_csv(const char *path) const {
+    std::ofstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    FrameMetrics frames[MetricsRing::capacity];
+    const size_t count = m_ring.snapshot(frames);
+
+    file << "frame,frame_ms";
+    for (const char *name : stage_names) {
+        file << "," << name << "_ms";
+    }
+    file << ",primary_rays,shadow_rays,shadow_occluded,node_visits,primitive_tests\n";
+    for (size_t i = 0; i < count; i++) {
+        const FrameMetrics &frame = frames[i];
+        file << frame.frame << "," << frame.frame_ms;
+        for (const double ms : frame.stage_ms) {
+            file << "," << ms;
+        }
+        file << "," << frame.counters.primary_rays << "," << frame.counters.shadow_rays << ","
+             << frame.counters.shadow_occluded << "," << frame.counters.node_visits << ","
+             << frame.counters.primitive_tests << "\n";
+    }
+
+    // Percentis ao fim, uma linha por percentil com o nome no lugar do número do quadro
+    const MetricsSummary summary = summarize();
+    const char *const labels[MetricsSummary::percentile_count] = {"p50", "p95", "p99"};
+    for (int p = 0; p < MetricsSummary::percentile_count; p++) {
+        file << labels[p] << "," << summary.frame_ms[p];
+        for (int stage = 0; stage < stage_count; stage++) {
+            file << "," << summary.stage_ms[stage][p];
+        }
+        file << ",,,,,\n";
+    }
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,80 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "Stats.h"
+
+// Medidas de um quadro. Os tempos das etapas de renderização são somados entre as
+// threads, o tempo do quadro é o tempo de parede de render_frame
+struct FrameMetrics {
+    uint64_t frame = 0;
+    double frame_ms = 0;
+    double stage_ms[stage_count] = {};
+    RayCounters counters;
+};
+
+// Percentis p50/p95/p99 dos quadros retidos
+struct MetricsSummary {
+    static constexpr int percentile_count = 3;
+    static constexpr double percentiles[percentile_count] = {0.50, 0.95, 0.99};
+
+    size_t frames = 0;
+    double frame_ms[percentile_count] = {};
+    double stage_ms[stage_count][percentile_count] = {};
+};
+
+// Anel com os últimos quadros, escrito por uma única thread e lido sem trava. Cada
+// posição tem um número de sequência ímpar enquanto é escrita, o leitor descarta
+// posições que mudaram durante a cópia
+class MetricsRing {
+  public:
+    static constexpr size_t capacity = 256;
+
+    void push(const FrameMetrics &frame);
+
+    // Copia os quadros retidos do mais antigo ao mais recente, retorna quantos
+    size_t snapshot(FrameMetrics *out) const;
+
+  private:
+    struct Slot {
+        std::atomic<uint64_t> sequence{0};
+        FrameMetrics frame;
+    };
+
+    Slot m_slots[capacity];
+    std::atomic<uint64_t> m_count{0};
+};
+
+// Coleta as medidas de cada quadro. Nada é impresso durante a renderização:
+// o resumo vai para a sobreposição na janela e para o arquivo gravado na saída
+class Metrics {
+  public:
+    // Converte os ciclos das etapas em milissegundos e registra o quadro.
+    // frame_cycles e frame_ns calibram a taxa do contador de ciclos
+    void record(double frame_ms, uint64_t frame_cycles, uint64_t frame_ns, const RayCounters &counters);
+
+    // Tempo de apresentação do último quadro, informado pela thread da janela
+    void set_present_time(uint64_t ns) { m_present_ns.store(ns, std::memory_order_relaxed); }
+
+    const FrameMetrics &last() const { return m_last; }
+    MetricsSummary summarize() const;
+
+    // Texto da sobreposição em ASCII, uma linha por \n
+    void format_overlay(char *out, size_t size) const;
+
+    // Grava os quadros retidos e os percentis em CSV
+    bool write_csv(const char *path) const;
+
+  private:
+    MetricsRing m_ring;
+    FrameMetrics m_last;
+    uint64_t m_frame = 0;
+    uint64_t m_total_cycles = 0;
+    uint64_t m_total_ns = 0;
+    std::atomic<uint64_t> m_present_ns{0};
+};
+
+#endif
@@ -0,0 +1,265 @@
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string_view>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+namespace {
+
+// Tamanho mínimo de um bloco, abaixo disso a divisão não compensa
+constexpr size_t min_chunk_size = 1 << 20;
+
+// Trecho do arquivo interpretado por uma thread. A primeira passada apenas conta vértices e
+// triângulos e coleta os nomes de materiais; a segunda escreve direto na posição final da malha
+struct ObjChunk {
+    const char *begin = nullptr;
+    const char *end = nullptr;
+    size_t vertex_count = 0;
+    size_t triangle_count = 0;
+    std::vector<std::string> material_names; // Na ordem do primeiro usemtl de cada nome
+    std::vector<std::string> libraries;
+    int32_t last_material = -1; // Índice em material_names em uso no fim do bloco, herdado pelo seguinte
+
+    // Preenchidos entre as passadas
+    size_t vertex_offset = 0;
+    size_t triangle_offset = 0;
+    std::vector<uint32_t> materials; // Material de cada nome de material_names
+    uint32_t inherited_material = ObjParser::no_material;
+    std::string error;
+};
+
+inline bool is_space(char c) { return c == ' ' || c == '\t'; }
+
+inline const char *skip_spaces(const char *p, const char *end) {
+    while (p < end && is_space(*p)) {
+        p++;
+    }
+    return p;
+}
+
+inline const char *skip_token(const char *p, const char *end) {
+    while (p < end && !is_space(*p)) {
+        p++;
+    }
+    return p;
+}
+
+// A linha começa com a palavra-chave seguida de espaço
+inline bool keyword(const char *p, const char *end, const char *word, size_t length) {
+    return static_cast<size_t>(end - p) > length && std::memcmp(p, word, length) == 0 && is_space(p[length]);
+}
+
+// Valores inválidos são lidos como 0, como no tinyobj
+inline const char *parse_float(const char *p, const char *end, float &value) {
+    p = skip_spaces(p, end);
+    if (p < end && *p == '+') {
+        p++;
+    }
+    const auto result = std::from_chars(p, end, value);
+    if (result.ec != std::errc()) {
+        value = 0.0F;
+        return skip_token(p, end);
+    }
+    return result.ptr;
+}
+
+// Chama visit(início, fim) para cada linha do bloco, já sem espaços iniciais e sem \r.
+// Para quando visit retorna false
+template <typename Visit>
+void for_each_line(const char *p, const char *end, Visit &&visit) {
+    while (p < end) {
+        const char *line_end = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        if (!line_end) {
+            line_end = end;
+        }
+        const char *next = line_end < end ? line_end + 1 : end;
+        if (line_end > p && line_end[-1] == '\r') {
+            line_end--;
+        }
+        if (!visit(skip_spaces(p, line_end), line_end)) {
+            return;
+        }
+        p = next;
+    }
+}
+
+int32_t material_name_index(const ObjChunk &chunk, const char *p, const char *line_end) {
+    p = skip_spaces(p + 6, line_end);
+    const std::string_view name(p, skip_token(p, line_end) - p);
+    const auto it = std::find(chunk.material_names.begin(), chunk.material_names.end(), name);
+    return it == chunk.material_names.end() ? -1 : it - chunk.material_names.begin();
+}
+
+// Primeira passada: tamanhos e nomes, sem interpretar números
+void count_chunk(ObjChunk &chunk) {
+    for_each_line(chunk.begin, chunk.end, [&](const char *p, const char *line_end) {
+        if (keyword(p, line_end, "v", 1)) {
+            chunk.vertex_count++;
+        } else if (keyword(p, line_end, "f", 1)) {
+            size_t corners = 0;
+            for (p = skip_spaces(p + 1, line_end); p < line_end; p = skip_spaces(skip_token(p, line_end), line_end)) {
+                corners++;
+            }
+            chunk.triangle_count += corners > 2 ? corners - 2 : 0;
+        } else if (keyword(p, line_end, "usemtl", 6)) {
+            chunk.last_material = material_name_index(chunk, p, line_end);
+            if (chunk.last_material < 0) {
+                p = skip_spaces(p + 6, line_end);
+                chunk.material_names.emplace_back(p, skip_token(p, line_end));
+                chunk.last_material = chunk.material_names.size() - 1;
+            }
+        } else if (keyword(p, line_end, "mtllib", 6)) {
+            for (p = skip_spaces(p + 6, line_end); p < line_end;) {
+                const char *token_end = skip_token(p, line_end);
+                chunk.libraries.emplace_back(p, token_end);
+                p = skip_spaces(token_end, line_end);
+            }
+        }
+        return true;
+    });
+}
+
+// Segunda passada: vértices, índices já absolutos e materiais escritos na malha pré-alocada
+void fill_chunk(ObjChunk &chunk, IndexedMesh &mesh) {
+    const size_t vertex_count = mesh.vertices.size();
+    Vector3 *vertex = mesh.vertices.data() + chunk.vertex_offset;
+    uint32_t *index = mesh.indices.data() + 3 * chunk.triangle_offset;
+    uint32_t *material = mesh.material.data() + chunk.triangle_offset;
+    uint32_t current_material = chunk.inherited_material;
+    std::vector<uint32_t> face;
+
+    for_each_line(chunk.begin, chunk.end, [&](const char *p, const char *line_end) {
+        if (keyword(p, line_end, "v", 1)) {
+            p = parse_float(p + 1, line_end, vertex->x);
+            p = parse_float(p, line_end, vertex->y);
+            parse_float(p, line_end, vertex->z);
+            vertex++;
+        } else if (keyword(p, line_end, "f", 1)) {
+            // Cada vértice da face é v, v/vt, v//vn ou v/vt/vn, apenas v é usado.
+            // Índices negativos são relativos ao último vértice lido
+            const int64_t vertices_read = vertex - mesh.vertices.data();
+            face.clear();
+            for (p = skip_spaces(p + 1, line_end); p < line_end;) {
+                long long value = 0;
+                const auto result = std::from_chars(p, line_end, value);
+                const int64_t resolved = value > 0 ? value - 1 : vertices_read + value;
+                if (result.ec != std::errc() || value == 0 || resolved < 0 ||
+                    static_cast<size_t>(resolved) >= vertex_count) {
+                    chunk.error = "índice de vértice inválido";
+                    return false;
+                }
+                face.push_back(resolved);
+                p = skip_spaces(skip_token(result.ptr, line_end), line_end);
+            }
+            for (size_t k = 2; k < face.size(); k++) {
+                *index++ = face[0];
+                *index++ = face[k - 1];
+                *index++ = face[k];
+                *material++ = current_material;
+            }
+        } else if (keyword(p, line_end, "usemtl", 6)) {
+            current_material = chunk.materials[material_name_index(chunk, p, line_end)];
+        }
+        return true;
+    });
+}
+
+} // namespace
+
+bool ObjParser::load(const char *path, IndexedMesh &mesh, std::vector<ObjMaterial> &materials, std::string &error,
+                     ThreadPool &pool) {
+    const MappedFile file(path);
+    if (!file.data()) {
+        error = std::string("não foi possível abrir ") + path;
+        return false;
+    }
+    const char *data = reinterpret_cast<const char *>(file.data());
+    const size_t size = file.size();
+
+    // Blocos de tamanho parecido, cada fronteira avança até o próximo fim de linha
+    const size_t chunk_count = std::clamp<size_t>(size / min_chunk_size, 1, 4 * pool.size());
+    std::vector<ObjChunk> chunks(chunk_count);
+    size_t begin = 0;
+    for (size_t i = 0; i < chunk_count; i++) {
+        size_t end = size;
+        if (i + 1 < chunk_count) {
+            const size_t position = std::max(begin, size * (i + 1) / chunk_count);
+            const void *newline = std::memchr(data + position, '\n', size - position);
+            end = newline ? static_cast<const char *>(newline) - data + 1 : size;
+        }
+        chunks[i].begin = data + begin;
+        chunks[i].end = data + end;
+        begin = end;
+    }
+
+    pool.run(chunk_count, [&](int i, int) { count_chunk(chunks[i]); });
+
+    // Arquivos .mtl, procurados no diretório do .obj
+    const std::string path_string(path);
+    const size_t slash = path_string.find_last_of('/');
+    const std::string directory = slash == std::string::npos ? "" : path_string.substr(0, slash + 1);
+    std::map<std::string, int> material_map;
+    std::vector<tinyobj::material_t> mtl_materials;
+    std::vector<std::string> loaded_libraries;
+    for (const ObjChunk &chunk : chunks) {
+        for (const std::string &library : chunk.libraries) {
+            if (std::find(loaded_libraries.begin(), loaded_libraries.end(), library) != loaded_libraries.end()) {
+                continue;
+            }
+            loaded_libraries.push_back(library);
+            std::ifstream stream(directory + library);
+            if (!stream) {
+                error = "arquivo de materiais " + directory + library + " não encontrado";
+                return false;
+            }
+            std::string warning;
+            tinyobj::LoadMtl(&material_map, &mtl_materials, &stream, &warning);
+        }
+    }
+    materials.clear();
+    for (const tinyobj::material_t &material : mtl_materials) {
+        materials.push_back({material.name, Vector3(material.diffuse[0], material.diffuse[1], material.diffuse[2])});
+    }
+
+    // Posição de cada bloco na malha e material herdado do bloco anterior
+    size_t vertex_count = 0;
+    size_t triangle_count = 0;
+    uint32_t current_material = no_material;
+    for (ObjChunk &chunk : chunks) {
+        chunk.vertex_offset = vertex_count;
+        chunk.triangle_offset = triangle_count;
+        vertex_count += chunk.vertex_count;
+        triangle_count += chunk.triangle_count;
+        for (const std::string &name : chunk.material_names) {
+            const auto it = material_map.find(name);
+            chunk.materials.push_back(it == material_map.end() ? no_material : it->second);
+        }
+        chunk.inherited_material = current_material;
+        if (chunk.last_material >= 0) {
+            current_material = chunk.materials[chunk.last_material];
+        }
+    }
+
+    // A malha é alocada uma única vez com o tamanho final e cada bloco escreve a sua parte
+    mesh.clear();
+    mesh.vertices.resize(vertex_count);
+    mesh.indices.resize(3 * triangle_count);
+    mesh.material.resize(triangle_count);
+
+    pool.run(chunk_count, [&](int i, int) { fill_chunk(chunks[i], mesh); });
+    for (const ObjChunk &chunk : chunks) {
+        if (!chunk.error.empty()) {
+            error = chunk.error + " em " + path;
+            return false;
+        }
+    }
+    return true;
+}
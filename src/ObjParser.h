@@ -0,0 +1,33 @@
+#ifndef OBJ_PARSER_H
+#define OBJ_PARSER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "IndexedMesh.h"
+
+class ThreadPool;
+
+// Leitura paralela de arquivos .obj. O arquivo é mapeado em memória e dividido em blocos
+// que terminam em fim de linha, cada bloco é lido por uma thread em duas passadas: a primeira
+// conta vértices e triângulos, a segunda escreve direto na posição final da malha já alocada,
+// sem representação intermediária. Apenas os registros v, f, usemtl e mtllib são usados,
+// polígonos viram leques de triângulos
+namespace ObjParser {
+    // Material de faces sem usemtl ou com um nome que não está nos arquivos .mtl
+    constexpr uint32_t no_material = UINT32_MAX;
+
+    struct ObjMaterial {
+        std::string name;
+        Vector3 diffuse;
+    };
+
+    // Substitui o conteúdo de mesh pelos vértices e triângulos do arquivo. mesh.material guarda o índice em
+    // materials ou no_material. Retorna false e descreve o problema em error se a leitura falhar.
+    // Os blocos são lidos pelas threads de pool, as mesmas da renderização
+    bool load(const char *path, IndexedMesh &mesh, std::vector<ObjMaterial> &materials, std::string &error,
+              ThreadPool &pool);
+};
+
+#endif
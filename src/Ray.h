@@ -0,0 +1,64 @@
+#ifndef RAY_H
+#define RAY_H
+
+#include <algorithm>
+#include <cmath>
+
+#include "Vector3.h"
+
+// Raio com o inverso da direção pré-calculado para os testes com caixas
+struct Ray {
+    Vector3 origin;
+    Vector3 direction;
+    Vector3 inv_direction;
+
+    Ray() = default;
+    Ray(const Vector3 &origin, const Vector3 &direction)
+        : origin(origin), direction(direction),
+          inv_direction(1.0F / direction.x, 1.0F / direction.y, 1.0F / direction.z) {}
+};
+
+// Pacote de raios primários com origem comum, percorrido em conjunto nas estruturas de aceleração.
+// Os intervalos do inverso das direções permitem descartar um nó para todos os raios de uma vez
+struct RayPacket {
+    static constexpr int max_size = 64;
+
+    Vector3 origin;
+    int size = 0;
+    Ray rays[max_size];
+    float t[max_size];
+    int index[max_size];
+
+    Vector3 inv_min; // Menor inverso da direção de cada eixo entre os raios do pacote
+    Vector3 inv_max; // Maior inverso da direção de cada eixo entre os raios do pacote
+    bool coherent = true;
+
+    explicit RayPacket(const Vector3 &origin) : origin(origin) {}
+
+    void add(const Vector3 &direction) {
+        rays[size] = Ray(origin, direction);
+        t[size] = INFINITY;
+        index[size] = -1;
+        size++;
+    }
+
+    // Calcula os intervalos, o pacote só é coerente se todas as direções
+    // tiverem o mesmo sinal em cada eixo
+    void finalize() {
+        inv_min = rays[0].inv_direction;
+        inv_max = rays[0].inv_direction;
+        for (int i = 0; i < size; i++) {
+            for (int axis = 0; axis < 3; axis++) {
+                inv_min[axis] = std::min(inv_min[axis], rays[i].inv_direction[axis]);
+                inv_max[axis] = std::max(inv_max[axis], rays[i].inv_direction[axis]);
+            }
+        }
+        coherent = true;
+        for (int axis = 0; axis < 3; axis++) {
+            coherent = coherent && std::isfinite(inv_min[axis]) && std::isfinite(inv_max[axis]) &&
+                       (inv_min[axis] > 0.0F) == (inv_max[axis] > 0.0F);
+        }
+    }
+};
+
+#endif
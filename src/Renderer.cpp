@@ -1,7 +1,14 @@
 #include "Renderer.h"
+#include "AllocCounter.h"
+#include "BVH.h"
+#include "Grid.h"
+#include "Stats.h"
+#include "WideBVH.h"
 
+#include <cassert>
 #include <chrono>
 #include <cmath>
+#include <fstream>
 #include <iterator>
 #include <vector>
 
@@ -51,214 +58,682 @@ Vector3 Triangle::get_normal() const {
     return edge1.cross(edge2).normalized();
 }
 
-// Inicializa o renderizador com o cenário presente
-void Renderer::init(int argc, char **argv) const {
-    glutInit(&argc, argv);
-    glutInitDisplayMode(GLUT_RGB);
-    glutInitWindowSize(m_window_width, m_window_height);
-    glutCreateWindow("Raycast");
-
-    // Register static wrapper functions
-    glutDisplayFunc(display_wrapper);
-    glutKeyboardFunc(keyboard_wrapper);
-    glutSpecialFunc(special_keys_wrapper);
-
-    glClearColor(0.0F, 0.0F, 0.0F, 1.0F);
-    glPointSize(1.0F);
-
-    glutMainLoop();
-}
-
 // Funções para criar o cenário
 void Renderer::set_ambient(float ambient) { m_ambient = ambient; }
-void Renderer::set_camera(Camera camera) { m_camera = camera; }
-void Renderer::add_triangle(const Triangle &triangle) { m_primitives.push_back(triangle); }
-void Renderer::add_object(std::vector<Triangle> object) {
-    m_primitives.insert(m_primitives.end(), std::make_move_iterator(object.begin()),
-                        std::make_move_iterator(object.end()));
+void Renderer::set_camera(Camera camera) {
+    invalidate_image();
+    m_camera = camera;
+    m_camera.set_aspect_ratio(static_cast<float>(m_window_width) / m_window_height);
+}
+void Renderer::set_size(int width, int height) {
+    invalidate_image();
+    m_window_width = width;
+    m_window_height = height;
+    m_camera.set_aspect_ratio(static_cast<float>(width) / height);
+}
+void Renderer::set_packet_size(int packet_size) { m_packet_size = packet_size; }
+void Renderer::set_accelerator(AcceleratorType type) { m_accelerator_type = type; }
+
+void Renderer::set_bvh_build(BVHBuildMode mode) { m_bvh_build = mode; }
+void Renderer::set_progressive(bool enabled) { m_progressive = enabled; }
+void Renderer::set_thread_count(int thread_count) {
+    m_thread_count = thread_count;
+    m_pool.reset();
+}
+int Renderer::get_thread_count() { return get_pool().size(); }
+ThreadPool &Renderer::get_pool() {
+    if (!m_pool) {
+        m_pool = std::make_unique<ThreadPool>(m_thread_count);
+    }
+    return *m_pool;
+}
+uint32_t Renderer::add_material(const Color &color) {
+    auto [it, inserted] = m_material_ids.try_emplace(std::make_tuple(color.r, color.g, color.b), m_materials.size());
+    if (inserted) {
+        m_materials.push_back(color);
+    }
+    return it->second;
+}
+void Renderer::add_triangle(const Triangle &triangle) {
+    m_geometry.add_triangle(triangle.v0, triangle.v1, triangle.v2, add_material(triangle.color));
+}
+void Renderer::add_object(const std::vector<Triangle> &object) {
+    for (const Triangle &triangle : object) {
+        add_triangle(triangle);
+    }
+}
+void Renderer::add_object(IndexedMesh object) {
+    if (m_geometry.triangle_count() == 0 && m_geometry.vertices.empty()) {
+        m_geometry = std::move(object);
+    } else {
+        m_geometry.append(object);
+    }
+}
+uint32_t Renderer::add_mesh(const std::vector<Triangle> &triangles) {
+    IndexedMesh mesh;
+    for (const Triangle &triangle : triangles) {
+        mesh.add_triangle(triangle.v0, triangle.v1, triangle.v2, add_material(triangle.color));
+    }
+    return add_mesh(std::move(mesh));
+}
+uint32_t Renderer::add_mesh(IndexedMesh mesh) {
+    m_mesh_geometry.push_back(std::move(mesh));
+    return m_mesh_geometry.size() - 1;
+}
+void Renderer::add_instance(uint32_t mesh, const Transform &object_to_world, std::optional<Color> color) {
+    Instance instance;
+    instance.mesh = mesh;
+    instance.object_to_world = object_to_world;
+    instance.world_to_object = object_to_world.inverse();
+    instance.material = color ? static_cast<int>(add_material(*color)) : -1;
+    m_instances.push_back(instance);
+}
+void Renderer::add_light(const Light& light) {
+    m_lights.push_back(light);
+    m_lights_dirty = true;
 }
-void Renderer::add_light(const Light& light) { m_lights.push_back(light); }
+void Renderer::set_light(int index, const Light &light) {
+    m_lights[index] = light;
+    m_lights_dirty = true;
+}
+void Renderer::set_light_cutoff(float cutoff) {
+    m_light_cutoff = std::max(0.0F, cutoff);
+    m_lights_dirty = true;
+}
+void Renderer::set_material(int index, const Color &color) { m_materials[index] = color; }
 void Renderer::add_lights(std::vector<Light> lights) {
     m_lights.insert(m_lights.end(), std::make_move_iterator(lights.begin()),
                         std::make_move_iterator(lights.end()));
+    m_lights_dirty = true;
 }
 
-void Renderer::display_wrapper() { Renderer::get_instance().render(); }
-void Renderer::keyboard_wrapper(unsigned char key, int x, int y) { Renderer::get_instance().keyboard(key, x, y); }
-void Renderer::special_keys_wrapper(int key, int x, int y) { Renderer::get_instance().special_keys(key, x, y); }
+// Reconstrói a hierarquia de luzes. A contribuição de uma luz a distância d é no máximo
+// max(cor) / (1 + atenuação * d), então fora do raio (max(cor) / corte - 1) / atenuação
+// ela fica abaixo do corte. Luzes sem atenuação têm alcance infinito
+void Renderer::build_light_tree() {
+    std::vector<Vector3> positions;
+    std::vector<float> radii;
+    positions.reserve(m_lights.size());
+    radii.reserve(m_lights.size());
+    for (const Light &light : m_lights) {
+        const float max_color = std::max({light.color.r, light.color.g, light.color.b});
+        float radius = INFINITY;
+        if (max_color <= 0.0F) {
+            radius = 0.0F;
+        } else if (m_light_cutoff > 0.0F && light.attenuation_factor > 0.0F) {
+            radius = std::max(0.0F, (max_color / m_light_cutoff - 1.0F) / light.attenuation_factor);
+        }
+        positions.push_back(light.pos);
+        radii.push_back(radius);
+    }
+    m_light_tree.build(positions, radii);
+    m_lights_dirty = false;
+}
 
-void Renderer::render() {
-    auto start = std::chrono::high_resolution_clock::now();
-    // Redimensiona o buffer da imagem caso haja redimensionamento da tela
-    if (m_pixel_buffer.size() != m_window_width * m_window_height * 3) {
-        m_pixel_buffer.resize(m_window_width * m_window_height * 3);
+Renderer::~Renderer() {
+    stop_render_thread();
+    dump_metrics();
+}
+
+void Renderer::dump_metrics() const {
+    if (!m_metrics_path.empty() && !m_metrics.write_csv(m_metrics_path.c_str())) {
+        std::cout << "Erro: não foi possível salvar " << m_metrics_path << std::endl;
     }
+}
+
+// Encerra a thread de renderização da janela, aguardando o quadro em andamento
+void Renderer::stop_render_thread() {
+    if (!m_render_thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_input_mutex);
+        m_stop_render = true;
+    }
+    m_input_cv.notify_one();
+    m_render_thread.join();
+}
 
-// Paraleliza o for externo com OpenMP
-#pragma omp parallel for
-    // Percorre cada pixel da tela calculando o raio e sua interseção
-    for (int x = 0; x < m_window_width; x++) {
-        for (int y = 0; y < m_window_height; y++) {
-            const Vector3 ray_dir = m_camera.get_ray_direction(x, y, m_window_width, m_window_height);
-            const Color pixel_color = trace_ray(m_camera.get_position(), ray_dir);
+void Renderer::set_heatmap(HeatmapMode mode) {
+    m_heatmap = mode;
+    invalidate_image();
+}
 
-            // Calcula o index para buffer
-            const int buffer_y = m_window_height - y - 1;
-            const int index = (buffer_y * m_window_width + x) * 3;
+const char *Renderer::heatmap_name(HeatmapMode mode) {
+    switch (mode) {
+    case HeatmapMode::PrimitiveTests:
+        return "prims";
+    case HeatmapMode::NodeVisits:
+        return "nodes";
+    case HeatmapMode::ShadowRays:
+        return "shadows";
+    case HeatmapMode::Cycles:
+        return "cycles";
+    default:
+        return "off";
+    }
+}
+
+// Descarta a imagem e o G-buffer, usada quando a câmera ou a geometria mudam.
+// Mudanças apenas de luzes e materiais mantêm o G-buffer
+void Renderer::invalidate_image() {
+    m_completed_step = 0;
+    m_gbuffer_valid = false;
+}
 
-            m_pixel_buffer[index] = static_cast<GLubyte>(pixel_color.r * 255);
-            m_pixel_buffer[index + 1] = static_cast<GLubyte>(pixel_color.g * 255);
-            m_pixel_buffer[index + 2] = static_cast<GLubyte>(pixel_color.b * 255);
+// Descarta a cena atual para que outra possa ser construída
+void Renderer::clear_scene() {
+    invalidate_image();
+    m_geometry.clear();
+    m_lights.clear();
+    m_lights_dirty = true;
+    m_mesh_geometry.clear();
+    m_meshes.clear();
+    m_instances.clear();
+    m_materials.clear();
+    m_material_ids.clear();
+    m_cache_path.clear();
+    m_cache_hash = 0;
+    m_cache_loaded = false;
+    m_store.clear();
+    m_accelerator.reset();
+    m_camera = Camera();
+    m_camera.set_aspect_ratio(static_cast<float>(m_window_width) / m_window_height);
+    m_ambient = 0.2;
+}
+
+void Renderer::build_acceleration() {
+    invalidate_image();
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // A construção usa as mesmas threads da renderização
+    ThreadPool &pool = get_pool();
+
+    // Uma cena lida do cache já tem os triângulos empacotados e a BVH
+    const bool prebuilt = m_cache_loaded && m_accelerator_type == AcceleratorType::BVH;
+    if (!prebuilt) {
+        // O empacotamento usado na interseção é derivado da geometria indexada. Uma nova
+        // construção acrescenta apenas os triângulos adicionados depois da anterior
+        m_store.append(m_geometry);
+
+        if (m_accelerator_type == AcceleratorType::Grid) {
+            m_accelerator = std::make_unique<UniformGrid>();
+        } else if (m_accelerator_type == AcceleratorType::Wide) {
+            auto wide = std::make_unique<WideBVH>();
+            wide->set_build_mode(m_bvh_build);
+            m_accelerator = std::move(wide);
+        } else {
+            auto bvh = std::make_unique<BVH>();
+            bvh->set_build_mode(m_bvh_build);
+            m_accelerator = std::move(bvh);
         }
+        m_accelerator->build(m_store, pool);
     }
 
-    // Desenha a imagem na tela
-    glClear(GL_COLOR_BUFFER_BIT);
-    glDrawPixels(m_window_width, m_window_height, GL_RGB, GL_UNSIGNED_BYTE, m_pixel_buffer.data());
-    glutSwapBuffers();
+    // Cada malha tem a sua BVH, construída uma única vez para todas as suas instâncias.
+    // O vetor de malhas não muda de tamanho depois daqui, as BVHs apontam para os armazenamentos
+    m_meshes.resize(m_mesh_geometry.size());
+    size_t mesh_triangles = 0;
+    for (size_t i = 0; i < m_meshes.size(); i++) {
+        Mesh &mesh = m_meshes[i];
+        mesh.store.append(m_mesh_geometry[i]);
+        mesh.bounds.grow(m_mesh_geometry[i].bounds());
+        mesh.bvh.set_build_mode(m_bvh_build);
+        mesh.bvh.build(mesh.store, pool);
+        mesh_triangles += mesh.store.size();
+    }
+    m_tlas.build(m_meshes, m_instances);
 
     auto end = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-    std::cout << "Tempo de renderização: " << duration.count() / 1000.0 << "ms\n";
-}
-
-void Renderer::keyboard(unsigned char key, int /*x*/, int /*y*/) {
-    const float speed = 0.1F;
-    switch (key) {
-    case 'w':
-    case 'W':
-        m_camera.move(0, 0, speed);
-        glutPostRedisplay();
-        break;
-    case 's':
-    case 'S':
-        m_camera.move(0, 0, -speed);
-        glutPostRedisplay();
-        break;
-    case 'a':
-    case 'A':
-        m_camera.move(-speed, 0, 0);
-        glutPostRedisplay();
-        break;
-    case 'd':
-    case 'D':
-        m_camera.move(speed, 0, 0);
-        glutPostRedisplay();
-        break;
-    case 'q':
-    case 'Q':
-        m_camera.move(0, speed, 0);
-        glutPostRedisplay();
-        break;
-    case 'e':
-    case 'E':
-        m_camera.move(0, -speed, 0);
-        glutPostRedisplay();
-        break;
-    case 27:
-        exit(0);
-        break;
-    }
-}
-
-void Renderer::special_keys(int key, int /*x*/, int /*y*/) {
-    const float speed = 0.05F;
-    switch (key) {
-    case GLUT_KEY_LEFT:
-        m_camera.rotate(speed, 0);
-        glutPostRedisplay();
-        break;
-    case GLUT_KEY_RIGHT:
-        m_camera.rotate(-speed, 0);
-        glutPostRedisplay();
-        break;
-    case GLUT_KEY_UP:
-        m_camera.rotate(0, speed);
-        glutPostRedisplay();
-        break;
-    case GLUT_KEY_DOWN:
-        m_camera.rotate(0, -speed);
-        glutPostRedisplay();
-        break;
-    }
-}
-
-Color Renderer::trace_ray(const Vector3 &origin, const Vector3 &direction) {
-    float closest_t = INFINITY;
-    int closest_idx = -1;
+    m_build_ms = duration.count() / 1000.0;
+    const auto *bvh = dynamic_cast<const BVH *>(m_accelerator.get());
+    const auto *wide = dynamic_cast<const WideBVH *>(m_accelerator.get());
+    m_sah_cost = bvh ? bvh->sah_cost() : wide ? wide->sah_cost() : 0.0F;
+    std::cout << "Tempo de construção (" << m_accelerator->name() << (prebuilt ? ", cache" : "")
+              << "): " << m_build_ms << "ms (" << m_store.size() << " triângulos";
+    if (bvh || wide) {
+        std::cout << ", custo SAH " << m_sah_cost;
+    }
+    if (!m_instances.empty()) {
+        std::cout << ", " << m_instances.size() << " instâncias de " << m_meshes.size() << " malhas com "
+                  << mesh_triangles << " triângulos";
+    }
+    std::cout << ")\n";
 
-    // Checa interseção do raio com todas as primitivas e escolhe a mais próxima
-    for (int i = 0; i < m_primitives.size(); i++) {
-        const Triangle &triangle = m_primitives[i];
-        if (auto t = triangle.ray_intersect(origin, direction)) {
-            if (*t < closest_t) {
-                closest_t = *t;
-                closest_idx = i;
-            }
+    // O cache guarda apenas a BVH da geometria sem instâncias
+    if (!m_cache_path.empty() && !m_cache_loaded && m_accelerator_type == AcceleratorType::BVH &&
+        m_instances.empty()) {
+        if (save_scene_cache()) {
+            std::cout << "Cache de cena gravado em " << m_cache_path << "\n";
+        } else {
+            std::cout << "Erro: não foi possível gravar o cache de cena " << m_cache_path << "\n";
         }
     }
 
-    // Caso não haja interseção no passo anterior retorna cor de fundo padrão
-    if (closest_idx == -1) {
-        return m_background_color;
+    // A renderização lê apenas os triângulos empacotados, a forma indexada deixa de ser residente
+    m_geometry = IndexedMesh();
+    for (IndexedMesh &mesh : m_mesh_geometry) {
+        mesh = IndexedMesh();
     }
+}
 
-    const Triangle &closest_triangle = m_primitives[closest_idx];
+// Calcula uma imagem da cena em m_pixel_buffer
+void Renderer::render_frame() {
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t start_cycles = read_cycles();
+    // Redimensiona o buffer da imagem caso haja redimensionamento da tela
+    if (m_pixel_buffer.size() != m_window_width * m_window_height * 3) {
+        m_pixel_buffer.resize(m_window_width * m_window_height * 3);
+        m_gbuffer.resize(m_window_width * m_window_height);
+        m_pixel_cost.resize(m_window_width * m_window_height);
+        invalidate_image();
+    }
 
-    // Ponto exato de interseção com o triângulo mais próximo
-    const Vector3 hit_point = origin + direction * closest_t;
+    // Com o G-buffer completo e a câmera parada apenas a iluminação é recalculada.
+    // O mapa de calor mede o custo completo de cada pixel e sempre traça os raios primários
+    const bool reshade = m_gbuffer_valid && m_heatmap == HeatmapMode::Off;
+    uint64_t generation_cycles = 0;
+    if (!reshade) {
+        // Reaproveita as direções dos raios primários enquanto a câmera apenas translada
+        const uint64_t generation_start = read_cycles();
+        m_camera.update_ray_directions(m_window_width, m_window_height);
+        generation_cycles = read_cycles() - generation_start;
+    }
+    if (m_lights_dirty) {
+        build_light_tree();
+    }
+    m_time_shadows = m_overlay || !m_metrics_path.empty();
+
+    ThreadPool &pool = get_pool();
+    m_thread_counters.assign(pool.size(), RayCounters());
+    // A memória temporária de cada thread guarda as direções dos raios primários de uma linha
+    // do bloco. O tamanho é fixo, então ela só é alocada no primeiro quadro
+    m_scratch.resize(pool.size());
+    for (ScratchArena &scratch : m_scratch) {
+        scratch.reserve(tile_size * sizeof(Vector3) + alignof(Vector3));
+    }
 
-    Vector3 normal = closest_triangle.get_normal();
-    // Aponta normal para direção da camera
-    if (normal.dot(direction) > 0) {
-        normal = normal * -1;
+    // Divide a imagem em blocos distribuídos entre as threads com roubo de trabalho,
+    // cada thread acumula os contadores dos seus blocos separadamente
+    const int tiles_x = (m_window_width + tile_size - 1) / tile_size;
+    const int tiles_y = (m_window_height + tile_size - 1) / tile_size;
+    pool.run(tiles_x * tiles_y, [&](int tile, int thread) {
+#ifdef RAYCAST_COUNT_ALLOCS
+        const uint64_t allocations = heap_allocation_count();
+#endif
+        const RayCounters before = t_ray_counters;
+        ScratchArena &scratch = m_scratch[thread];
+        scratch.reset();
+
+        const int x0 = (tile % tiles_x) * tile_size;
+        const int y0 = (tile / tiles_x) * tile_size;
+        const int x1 = std::min(x0 + tile_size, m_window_width);
+        const int y1 = std::min(y0 + tile_size, m_window_height);
+        if (reshade) {
+            shade_tile(x0, y0, x1, y1);
+        } else {
+            render_tile(x0, y0, x1, y1, scratch);
+        }
+
+        m_thread_counters[thread] += t_ray_counters - before;
+#ifdef RAYCAST_COUNT_ALLOCS
+        // O traçado dos blocos não pode usar o heap
+        assert(heap_allocation_count() == allocations && "Alocação no heap durante a renderização");
+#endif
+    });
+
+    m_frame_counters = RayCounters();
+    for (const RayCounters &counters : m_thread_counters) {
+        m_frame_counters += counters;
     }
+    m_frame_counters.stage_cycles[static_cast<int>(Stage::RayGeneration)] += generation_cycles;
+    if (m_heatmap != HeatmapMode::Off) {
+        apply_heatmap();
+    }
+    m_completed_step = m_progressive_step;
+    // Após a passada de resolução completa todo pixel tem sua amostra no G-buffer
+    m_gbuffer_valid = m_progressive_step == 1;
 
-    std::vector<float> intensities; // Guarda a intensidade de cada luz que atinge o ponto
-    // Avalia o impacto de cada luz na intensidade do raio
-    for (auto& light : m_lights) {
-        bool hit = false;
-        Vector3 to_light = (light.pos - hit_point);
-        const float light_t = to_light.length();
-        to_light = to_light.normalized();
+    const uint64_t frame_cycles = read_cycles() - start_cycles;
+    const auto frame_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    m_metrics.record(frame_ns.count() / 1e6, frame_cycles, frame_ns.count(), m_frame_counters);
+}
 
-        // Shadow ray, checa colisão a partir do ponto de interseção até a luz
-        // caso haja um triângulo no caminho o raio é uma sombra para aquela luz
-        for (int i = 0; i < m_primitives.size(); i++) {
-            // Evita checar com o próprio triangulo
-            if (i == closest_idx) {
+// Salva a última imagem calculada em formato PPM binário
+bool Renderer::save_ppm(const char *path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    file << "P6\n" << m_window_width << " " << m_window_height << "\n255\n";
+    // O buffer começa pela linha de baixo, como espera o glDrawPixels
+    const size_t row_size = m_window_width * 3;
+    for (int y = m_window_height - 1; y >= 0; y--) {
+        file.write(reinterpret_cast<const char *>(m_pixel_buffer.data() + y * row_size), row_size);
+    }
+    return static_cast<bool>(file);
+}
+
+// Compara a última imagem calculada com um PPM gravado por save_ppm, pixel a pixel
+long Renderer::compare_ppm(const char *path) const {
+    std::ifstream file(path, std::ios::binary);
+    std::string magic;
+    int width = 0;
+    int height = 0;
+    int max_value = 0;
+    file >> magic >> width >> height >> max_value;
+    file.get();
+    if (!file || magic != "P6" || width != m_window_width || height != m_window_height || max_value != 255) {
+        return -1;
+    }
+
+    const size_t row_size = m_window_width * 3;
+    std::vector<uint8_t> row(row_size);
+    long differing = 0;
+    for (int y = m_window_height - 1; y >= 0; y--) {
+        if (!file.read(reinterpret_cast<char *>(row.data()), row_size)) {
+            return -1;
+        }
+        const uint8_t *pixels = m_pixel_buffer.data() + y * row_size;
+        for (size_t x = 0; x < row_size; x += 3) {
+            if (pixels[x] != row[x] || pixels[x + 1] != row[x + 1] || pixels[x + 2] != row[x + 2]) {
+                differing++;
+            }
+        }
+    }
+    return differing;
+}
+
+// Calcula os pixels de um bloco da imagem. Na renderização progressiva apenas uma amostra
+// a cada m_progressive_step pixels é calculada e preenche o seu quadrado. Ao refinar, as amostras
+// que já existem na grade mais grosseira da passada anterior são mantidas; uma passada com o mesmo
+// espaçamento da anterior calcula todas as amostras de novo. No modo de pacotes os raios de cada
+// grupo de m_packet_size x m_packet_size amostras atravessam a estrutura de aceleração juntos
+void Renderer::render_tile(int x0, int y0, int x1, int y1, ScratchArena &scratch) {
+    const Vector3 origin = m_camera.get_position();
+    const int step = m_progressive_step;
+    const int reuse = m_completed_step > step ? m_completed_step : 0;
+    auto reused = [&](int x, int y) { return reuse > 0 && x % reuse == 0 && y % reuse == 0; };
+
+    // O mapa de calor mede cada raio individualmente e não usa pacotes
+    const bool heatmap = m_heatmap != HeatmapMode::Off;
+    if (m_packet_size <= 1 || heatmap) {
+        // Cada linha de amostras do bloco passa pelas etapas em sequência, para que cada
+        // uma seja medida separadamente: direções, interseção primária e sombreamento
+        const size_t scratch_mark = scratch.mark();
+        Vector3 *directions = scratch.allocate<Vector3>(x1 - x0);
+        for (int y = y0; y < y1; y += step) {
+            StageTimer timer(Stage::RayGeneration);
+            int count = 0;
+            for (int x = x0; x < x1; x += step) {
+                if (!reused(x, y)) {
+                    directions[count++] = m_camera.ray_direction(x, y);
+                }
+            }
+
+            timer.lap(Stage::Primary);
+            int ray = 0;
+            for (int x = x0; x < x1; x += step) {
+                if (!reused(x, y)) {
+                    const uint64_t cost_start = heatmap ? heatmap_counter() : 0;
+                    m_gbuffer[y * m_window_width + x] = trace_ray(origin, directions[ray++]);
+                    if (heatmap) {
+                        m_pixel_cost[y * m_window_width + x] = heatmap_counter() - cost_start;
+                    }
+                }
+            }
+
+            timer.lap(Stage::Shading);
+            for (int x = x0; x < x1; x += step) {
+                if (!reused(x, y)) {
+                    const uint64_t cost_start = heatmap ? heatmap_counter() : 0;
+                    fill_block(x, y, step, shade(m_gbuffer[y * m_window_width + x]));
+                    if (heatmap) {
+                        fill_cost_block(x, y, step,
+                                        m_pixel_cost[y * m_window_width + x] + heatmap_counter() - cost_start);
+                    }
+                }
+            }
+        }
+        scratch.rewind(scratch_mark);
+        return;
+    }
+
+    const int packet_span = m_packet_size * step;
+    for (int packet_y = y0; packet_y < y1; packet_y += packet_span) {
+        for (int packet_x = x0; packet_x < x1; packet_x += packet_span) {
+            const int packet_x1 = std::min(packet_x + packet_span, x1);
+            const int packet_y1 = std::min(packet_y + packet_span, y1);
+
+            StageTimer timer(Stage::RayGeneration);
+            RayPacket packet(origin);
+            for (int y = packet_y; y < packet_y1; y += step) {
+                for (int x = packet_x; x < packet_x1; x += step) {
+                    if (!reused(x, y)) {
+                        packet.add(m_camera.ray_direction(x, y));
+                    }
+                }
+            }
+            if (packet.size == 0) {
                 continue;
             }
 
-            const Triangle &triangle = m_primitives[i];
-            if (auto t = triangle.ray_intersect(hit_point, to_light)) {
-                // Caso o ponto de interseção seja após o ponto de posição da luz
-                // essa interseção não deve ser contada
-                if (t > light_t) {
-                    continue;
+            timer.lap(Stage::Primary);
+            t_ray_counters.primary_rays += packet.size;
+            m_accelerator->intersect_packet(packet);
+            int instance[RayPacket::max_size];
+            std::fill(instance, instance + packet.size, -1);
+            if (!m_tlas.empty()) {
+                for (int i = 0; i < packet.size; i++) {
+                    m_tlas.intersect(packet.rays[i], packet.t[i], packet.index[i], instance[i]);
+                }
+            }
+
+            int ray = 0;
+            for (int y = packet_y; y < packet_y1; y += step) {
+                for (int x = packet_x; x < packet_x1; x += step) {
+                    if (!reused(x, y)) {
+                        m_gbuffer[y * m_window_width + x] =
+                            resolve_hit(origin, packet.rays[ray].direction, packet.t[ray], packet.index[ray], instance[ray]);
+                        ray++;
+                    }
+                }
+            }
+
+            timer.lap(Stage::Shading);
+            for (int y = packet_y; y < packet_y1; y += step) {
+                for (int x = packet_x; x < packet_x1; x += step) {
+                    if (!reused(x, y)) {
+                        fill_block(x, y, step, shade(m_gbuffer[y * m_window_width + x]));
+                    }
                 }
-                hit = true;
-                break;
             }
         }
+    }
+}
 
-        const float intensity = normal.dot(to_light) * (1.0 / (1.0 + light.attenuation_factor * light_t));
+// Recalcula a cor dos pixels de um bloco a partir do G-buffer, sem raios primários
+void Renderer::shade_tile(int x0, int y0, int x1, int y1) {
+    StageTimer timer(Stage::Shading);
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            write_pixel(x, y, shade(m_gbuffer[y * m_window_width + x]));
+        }
+    }
+}
 
-        // Caso o produto seja menor que 0 a luz esta no lado contrario ao triângulo
-        // e portanto não deve interferir na intensidade
-        if (!hit && intensity > 0) {
-            intensities.push_back(intensity);
-        } else {
-            intensities.push_back(0);
+// Preenche o quadrado de lado size a partir de (x, y) com a cor de uma amostra
+void Renderer::fill_block(int x, int y, int size, const Color &color) {
+    const int x1 = std::min(x + size, m_window_width);
+    const int y1 = std::min(y + size, m_window_height);
+    for (int block_y = y; block_y < y1; block_y++) {
+        for (int block_x = x; block_x < x1; block_x++) {
+            write_pixel(block_x, block_y, color);
         }
     }
+}
+
+// Valor atual do contador medido pelo mapa de calor, a diferença entre duas leituras
+// é o custo do trabalho feito entre elas
+uint64_t Renderer::heatmap_counter() const {
+    switch (m_heatmap) {
+    case HeatmapMode::PrimitiveTests:
+        return t_ray_counters.primitive_tests;
+    case HeatmapMode::NodeVisits:
+        return t_ray_counters.node_visits;
+    case HeatmapMode::ShadowRays:
+        return t_ray_counters.shadow_rays;
+    case HeatmapMode::Cycles:
+        return read_cycles();
+    default:
+        return 0;
+    }
+}
+
+void Renderer::fill_cost_block(int x, int y, int size, uint64_t cost) {
+    const int x1 = std::min(x + size, m_window_width);
+    const int y1 = std::min(y + size, m_window_height);
+    for (int block_y = y; block_y < y1; block_y++) {
+        std::fill(m_pixel_cost.begin() + block_y * m_window_width + x,
+                  m_pixel_cost.begin() + block_y * m_window_width + x1, cost);
+    }
+}
+
+// Substitui a imagem pelas cores do custo de cada pixel, do azul (sem custo) ao
+// vermelho (maior custo do quadro), passando por ciano, verde e amarelo
+void Renderer::apply_heatmap() {
+    const uint64_t max_cost = std::max<uint64_t>(1, *std::max_element(m_pixel_cost.begin(), m_pixel_cost.end()));
+    const Color ramp[] = {Color(0, 0, 1), Color(0, 1, 1), Color(0, 1, 0), Color(1, 1, 0), Color(1, 0, 0)};
+    const int segments = std::size(ramp) - 1;
+
+    for (int y = 0; y < m_window_height; y++) {
+        for (int x = 0; x < m_window_width; x++) {
+            const float value = static_cast<float>(m_pixel_cost[y * m_window_width + x]) / max_cost * segments;
+            const int segment = std::min(static_cast<int>(value), segments - 1);
+            const float f = value - segment;
+            write_pixel(x, y, ramp[segment] * (1.0F - f) + ramp[segment + 1] * f);
+        }
+    }
+    m_heatmap_max = max_cost;
+}
+
+void Renderer::write_pixel(int x, int y, const Color &color) {
+    // Calcula o index para buffer
+    const int buffer_y = m_window_height - y - 1;
+    const int index = (buffer_y * m_window_width + x) * 3;
+
+    m_pixel_buffer[index] = static_cast<uint8_t>(color.r * 255);
+    m_pixel_buffer[index + 1] = static_cast<uint8_t>(color.g * 255);
+    m_pixel_buffer[index + 2] = static_cast<uint8_t>(color.b * 255);
+}
+
+// Interseção primária de um raio, guardada no G-buffer
+GBufferSample Renderer::trace_ray(const Vector3 &origin, const Vector3 &direction) {
+    float closest_t = INFINITY;
+    int closest_idx = -1;
+
+    t_ray_counters.primary_rays++;
+    // Percorre a estrutura de aceleração buscando a primitiva mais próxima
+    const Ray ray(origin, direction);
+    m_accelerator->intersect(ray, closest_t, closest_idx);
+    // Instâncias só substituem a interseção se estiverem mais próximas
+    int closest_instance = -1;
+    m_tlas.intersect(ray, closest_t, closest_idx, closest_instance);
+
+    return resolve_hit(origin, direction, closest_t, closest_idx, closest_instance);
+}
+
+// Monta a amostra do G-buffer a partir da interseção mais próxima de um raio
+GBufferSample Renderer::resolve_hit(const Vector3 &origin, const Vector3 &direction, float closest_t,
+                                    int closest_idx, int closest_instance) const {
+    GBufferSample sample;
+    if (closest_idx == -1) {
+        return sample;
+    }
+
+    sample.triangle = closest_idx;
+    sample.t = closest_t;
+    // Ponto exato de interseção com o triângulo mais próximo
+    sample.hit_point = origin + direction * closest_t;
+
+    sample.instance = closest_instance;
+    if (closest_instance == -1) {
+        sample.normal = m_store.normal(closest_idx);
+        sample.material = m_store.material[closest_idx];
+    } else {
+        // Normais vão do objeto para o mundo pela transposta da inversa
+        const Instance &instance = m_instances[closest_instance];
+        const Mesh &mesh = m_meshes[instance.mesh];
+        sample.normal = instance.world_to_object.transpose_vector(mesh.store.normal(closest_idx)).normalized();
+        sample.material = instance.material >= 0 ? instance.material : mesh.store.material[closest_idx];
+    }
+    // Aponta normal para direção da camera
+    if (sample.normal.dot(direction) > 0) {
+        sample.normal = sample.normal * -1;
+    }
+    return sample;
+}
+
+// Calcula a cor de uma amostra do G-buffer, lançando os shadow rays para cada luz
+Color Renderer::shade(const GBufferSample &sample) {
+    // Caso não haja interseção no passo anterior retorna cor de fundo padrão
+    if (sample.triangle == -1) {
+        return m_background_color;
+    }
+
+    const Color &closest_color = m_materials[sample.material];
+    const Vector3 &hit_point = sample.hit_point;
+    const Vector3 &normal = sample.normal;
+
+    // Origem dos shadow rays deslocada na direção da normal para evitar que o raio
+    // atinja a própria superfície, o deslocamento acompanha a escala da cena
+    const float bias = shadow_bias * std::max({1.0F, std::fabs(hit_point.x), std::fabs(hit_point.y),
+                                               std::fabs(hit_point.z)});
+    const Vector3 shadow_origin = hit_point + normal * bias;
 
     // Calulo final da cor, considerando luz ambiente, a cor do objeto e a cor da luz e sua intensidade
-    Color result = closest_triangle.color * m_ambient;
+    Color result = closest_color * m_ambient;
     const float diffuse = 1.0F - m_ambient;
-    for (int i = 0; i < m_lights.size(); i++) {
-        result = result + (m_lights[i].color * closest_triangle.color * (intensities[i] * diffuse));
-    }
+
+    // Cada luz cujo alcance contém o ponto é acumulada direto no resultado, sem memória temporária
+    m_light_tree.query(hit_point, [&](uint32_t light_idx) {
+        const Light &light = m_lights[light_idx];
+        Vector3 to_light = (light.pos - hit_point);
+        const float light_t = to_light.length();
+        to_light = to_light.normalized();
+
+        // Caso o produto seja menor que 0 a luz esta no lado contrario ao triângulo
+        // e portanto não deve interferir na intensidade, nem é preciso lançar o shadow ray
+        const float n_dot_l = normal.dot(to_light);
+        if (n_dot_l <= 0) {
+            return;
+        }
+
+        // Shadow ray, checa colisão a partir do ponto de interseção até a luz
+        // caso haja um triângulo no caminho o raio é uma sombra para aquela luz.
+        // Com o overlay ou as métricas em CSV os shadow rays são medidos à parte, descontados
+        // do sombreamento; sem eles o laço não paga as duas leituras do contador por raio
+        t_ray_counters.shadow_rays++;
+        const Ray shadow_ray(shadow_origin, to_light);
+        const float shadow_t = light_t - bias;
+        bool occluded;
+        if (m_time_shadows) {
+            StageTimer shadow_timer(Stage::Shadow, Stage::Shading);
+            occluded = m_accelerator->occluded(shadow_ray, shadow_t) || m_tlas.occluded(shadow_ray, shadow_t);
+        } else {
+            occluded = m_accelerator->occluded(shadow_ray, shadow_t) || m_tlas.occluded(shadow_ray, shadow_t);
+        }
+        if (occluded) {
+            t_ray_counters.shadow_occluded++;
+            return;
+        }
+
+        const float intensity = n_dot_l * (1.0 / (1.0 + light.attenuation_factor * light_t));
+        result = result + (light.color * closest_color * (intensity * diffuse));
+    });
+
     result.saturate(); // Evita overflow
 
     return result;
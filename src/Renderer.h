@@ -1,10 +1,28 @@
 #ifndef RENDERER_H
 #define RENDERER_H
 
+#include "Accelerator.h"
 #include "Camera.h"
-#include <GL/glut.h>
+#include "FrameExchange.h"
+#include "IndexedMesh.h"
+#include "LightTree.h"
+#include "Metrics.h"
+#include "ScratchArena.h"
+#include "Stats.h"
+#include "TLAS.h"
+#include "ThreadPool.h"
+#include "TriangleStore.h"
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <string>
+#include <thread>
+#include <tuple>
 #include <vector>
 
 // Cores e suas operações
@@ -50,6 +68,29 @@ struct Light {
   Light(Vector3 pos, Color color, float attenuation_factor) : pos(pos), color(color), attenuation_factor(attenuation_factor) {};
 };
 
+// Tecla recebida pela janela, repassada à thread de renderização
+struct KeyEvent {
+    int key;
+    bool special; // Teclas especiais do GLUT (setas)
+};
+
+// Interseção primária de um pixel. Guardada por pixel para que mudanças apenas
+// de luzes ou materiais recalculem a iluminação sem traçar os raios primários de novo
+struct GBufferSample {
+    int triangle = -1; // -1 quando o raio não atinge nenhum triângulo
+    int instance = -1; // Instância atingida, -1 para a geometria sem instâncias
+    uint32_t material = 0;
+    float t = INFINITY;
+    Vector3 hit_point;
+    Vector3 normal; // Voltada para a câmera
+};
+
+// Estruturas de aceleração disponíveis
+enum class AcceleratorType { BVH, Wide, Grid };
+
+// Modo de depuração que pinta cada pixel pelo custo do seu cálculo em vez da cor sombreada
+enum class HeatmapMode { Off, PrimitiveTests, NodeVisits, ShadowRays, Cycles };
+
 // Renderer é uma classe para utilizar o raycasting
 // devido a a natureza do OpenGL a classe é instanciada apenas
 // uma vez (Singleton)
@@ -57,14 +98,81 @@ class Renderer {
   private:
     static Renderer &instance;
 
-    std::vector<Triangle> m_primitives;
+    // Deslocamento relativo da origem dos shadow rays
+    static constexpr float shadow_bias = 1e-4F;
+    // Lado dos blocos de pixels distribuídos entre as threads
+    static constexpr int tile_size = 32;
+    // Renderização progressiva: espaçamento das amostras na primeira passada após um movimento
+    // e tempo sem entrada antes de cada refinamento
+    static constexpr int progressive_start_step = 8;
+    static constexpr int progressive_delay_ms = 60;
+    // Intervalo em que a janela verifica se há quadro novo para apresentar
+    static constexpr int present_poll_ms = 4;
+
+    IndexedMesh m_geometry;         // Triângulos sem instâncias ainda não empacotados, na forma indexada
+    std::vector<Color> m_materials; // Cores distintas da cena, indexadas pelas malhas
+    std::map<std::tuple<float, float, float>, uint32_t> m_material_ids; // Índice de cada cor já usada
+    TriangleStore m_store;          // Triângulos empacotados usados na renderização
+    AcceleratorType m_accelerator_type = AcceleratorType::BVH;
+    BVHBuildMode m_bvh_build = BVHBuildMode::Quality;
+    std::unique_ptr<Accelerator> m_accelerator;
+    // Geometria instanciada: malhas compartilhadas e suas instâncias sob a TLAS
+    std::vector<IndexedMesh> m_mesh_geometry; // Liberadas depois da construção, como m_geometry
+    std::vector<Mesh> m_meshes;
+    std::vector<Instance> m_instances;
+    TLAS m_tlas;
+    // Cache binário da cena, vazio quando a cena não veio de um arquivo
+    std::string m_cache_path;
+    uint64_t m_cache_hash = 0; // Hash do arquivo de origem
+    bool m_cache_loaded = false; // Triângulos empacotados e BVH vieram do cache
+    double m_build_ms = 0.0;  // Duração da última construção
+    float m_sah_cost = 0.0F;  // Qualidade da última BVH construída (a binária, na BVH larga), 0 para a grade
     std::vector<Light> m_lights;
+    LightTree m_light_tree;           // Esferas de alcance das luzes
+    bool m_lights_dirty = true;       // Luzes mudaram desde a última construção da hierarquia
+    float m_light_cutoff = 1.0F / 256; // Intensidade abaixo da qual uma luz é ignorada
     Camera m_camera;
     int m_window_width = 800;
     int m_window_height = 600;
     float m_ambient = 0.2;
-    std::vector<GLubyte> m_pixel_buffer;
+    std::vector<uint8_t> m_pixel_buffer;
+    std::vector<GBufferSample> m_gbuffer;
+    std::vector<uint64_t> m_pixel_cost; // Custo de cada pixel no modo de mapa de calor
+    HeatmapMode m_heatmap = HeatmapMode::Off;
+    uint64_t m_heatmap_max = 0; // Custo que corresponde ao vermelho no último quadro
+    bool m_gbuffer_valid = false; // Todos os pixels têm amostra para a câmera atual
     Color m_background_color;
+    RayCounters m_frame_counters; // Trabalho realizado no último quadro
+    Metrics m_metrics;
+    bool m_overlay = false;     // Mostra as métricas sobre a imagem na janela
+    std::string m_metrics_path; // Arquivo CSV gravado na saída, vazio para não gravar
+    bool m_time_shadows = false; // Mede os shadow rays à parte do sombreamento no quadro atual
+    std::vector<RayCounters> m_thread_counters;
+    std::vector<ScratchArena> m_scratch; // Memória temporária de cada thread do pool
+    int m_thread_count = 0; // 0 usa todos os núcleos
+    std::unique_ptr<ThreadPool> m_pool;
+    int m_packet_size = 1; // Lado dos blocos de raios primários, 1 desativa os pacotes
+
+    // Estado da renderização progressiva
+    bool m_progressive = false;
+    int m_progressive_step = 1; // Espaçamento entre amostras da próxima passada
+    int m_completed_step = 0;   // Espaçamento da última passada concluída, 0 se a imagem é inválida
+    int m_selected_light = 0; // Luz ajustada pelo teclado
+    std::chrono::steady_clock::time_point m_last_input;
+    std::chrono::steady_clock::time_point m_refine_at; // Próxima passada não ocorre antes disto
+
+    // Apresentação assíncrona. A thread de renderização é dona de todo o estado da cena,
+    // a thread do GLUT apenas repassa as teclas e apresenta o quadro mais recente
+    FrameExchange m_frames;
+    std::thread m_render_thread;
+    std::mutex m_input_mutex; // Protege a fila de teclas e os pedidos abaixo
+    std::condition_variable m_input_cv;
+    std::vector<KeyEvent> m_key_events;
+    bool m_frame_requested = false;
+    bool m_stop_render = false;
+    bool m_redraw = false; // Usado apenas pela thread de renderização
+    unsigned int m_pbo[2] = {0, 0}; // Pixel buffer objects do upload, 0 se não suportados
+    int m_pbo_index = 0;
 
     Renderer() {};
 
@@ -72,12 +180,30 @@ class Renderer {
     static void display_wrapper();
     static void keyboard_wrapper(unsigned char key, int x, int y);
     static void special_keys_wrapper(int key, int x, int y);
+    static void present_poll_wrapper(int value);
 
-    void render();
-    Color trace_ray(const Vector3 &origin, const Vector3 &direction);
+    void present();
+    void present_poll();
+    void post_key(KeyEvent event);
+    void render_loop();
+    void stop_render_thread();
+    void render_tile(int x0, int y0, int x1, int y1, ScratchArena &scratch);
+    void shade_tile(int x0, int y0, int x1, int y1);
+    void build_light_tree();
+    void fill_block(int x, int y, int size, const Color &color);
+    void write_pixel(int x, int y, const Color &color);
+    uint64_t heatmap_counter() const;
+    void fill_cost_block(int x, int y, int size, uint64_t cost);
+    void apply_heatmap();
+    GBufferSample trace_ray(const Vector3 &origin, const Vector3 &direction);
+    GBufferSample resolve_hit(const Vector3 &origin, const Vector3 &direction, float closest_t, int closest_idx,
+                              int closest_instance) const;
+    Color shade(const GBufferSample &sample);
 
     void keyboard(unsigned char key, int x, int y);
     void special_keys(int key, int x, int y);
+    void camera_moved();
+    void refine();
 
   public:
     // Deleta construtores para o padrão Singleton
@@ -86,20 +212,86 @@ class Renderer {
     Renderer(const Renderer &) = delete;
     void operator=(const Renderer &) = delete;
 
-    ~Renderer() = default;
+    ~Renderer();
 
     static Renderer &get_instance() {
         static Renderer instance;
         return instance;
     }
 
-    void init(int argc, char **argv) const;
+    void init(int argc, char **argv);
     void set_ambient(float ambient);
     void set_camera(Camera camera);
+    void set_size(int width, int height);
+    void set_overlay(bool enabled) { m_overlay = enabled; }
+    void set_heatmap(HeatmapMode mode);
+    static const char *heatmap_name(HeatmapMode mode);
+    HeatmapMode get_heatmap() const { return m_heatmap; }
+    uint64_t get_heatmap_max() const { return m_heatmap_max; }
+    void set_metrics_path(const std::string &path) { m_metrics_path = path; }
+    // Grava as métricas em m_metrics_path, se definido. Chamada também na destruição
+    void dump_metrics() const;
+    const Metrics &get_metrics() const { return m_metrics; }
+    void set_progressive(bool enabled);
+    void set_thread_count(int thread_count);
+    int get_thread_count();
+    // Threads de renderização, criadas no primeiro uso com set_thread_count. Também constroem
+    // a estrutura de aceleração e leem os arquivos .obj
+    ThreadPool &get_pool();
+    const Camera &get_camera() const { return m_camera; }
+    const RayCounters &get_frame_counters() const { return m_frame_counters; }
+    size_t get_triangle_count() const { return m_store.size(); }
+    double get_build_ms() const { return m_build_ms; }
+    float get_sah_cost() const { return m_sah_cost; }
+    void set_packet_size(int packet_size);
+    void set_accelerator(AcceleratorType type);
+    // Modo de construção da BVH da cena e das malhas instanciadas, o cache guarda o modo usado
+    void set_bvh_build(BVHBuildMode mode);
+    // Índice do material com esta cor, cores repetidas compartilham o mesmo material
+    uint32_t add_material(const Color &color);
     void add_triangle(const Triangle &triangle);
-    void add_object(std::vector<Triangle> object);
+    void add_object(const std::vector<Triangle> &object);
+    // Malha já indexada, com materiais obtidos de add_material. Numa cena vazia
+    // a malha passa a ser o armazenamento da cena, sem cópia
+    void add_object(IndexedMesh object);
+
+    // Instanciamento: a malha é guardada uma única vez e cada instância guarda apenas
+    // a transformação e uma cor opcional que substitui a dos triângulos
+    uint32_t add_mesh(const std::vector<Triangle> &triangles);
+    uint32_t add_mesh(IndexedMesh mesh);
+    void add_instance(uint32_t mesh, const Transform &object_to_world, std::optional<Color> color = std::nullopt);
     void add_light(const Light& light);
     void add_lights(std::vector<Light> light);
+
+    // Alteram luzes e materiais existentes, o próximo quadro reaproveita o G-buffer
+    void set_light(int index, const Light &light);
+    // Intensidade mínima para uma luz ser avaliada, 0 avalia todas as luzes em todo ponto
+    void set_light_cutoff(float cutoff);
+    void set_material(int index, const Color &color);
+    const std::vector<Light> &get_lights() const { return m_lights; }
+
+    void clear_scene();
+    // Descarta a imagem e o G-buffer, o próximo quadro traça todos os raios primários.
+    // O benchmark chama antes de cada quadro medido para não medir apenas o sombreamento
+    void invalidate_image();
+
+    // Cache binário da cena (SceneCache.cpp). load_scene_cache substitui a geometria, os materiais,
+    // as luzes e a câmera pelos do cache e já deixa a BVH pronta, retorna false se o cache não existe
+    // ou não corresponde ao hash. Com set_scene_cache, build_acceleration grava o cache ao terminar
+    bool load_scene_cache(const std::string &path, uint64_t source_hash);
+    void set_scene_cache(const std::string &path, uint64_t source_hash);
+    bool save_scene_cache() const;
+
+    // Calcula uma imagem sem janela e a salva em disco, usados no modo headless
+    void render_frame();
+    bool save_ppm(const char *path) const;
+    // Conta os pixels da última imagem que diferem de um PPM de referência salvo por save_ppm,
+    // retorna -1 se o arquivo não existe ou tem outra resolução
+    long compare_ppm(const char *path) const;
+
+    // Empacota os triângulos e constrói a estrutura de aceleração,
+    // deve ser chamada com a cena completa e antes de init
+    void build_acceleration();
 };
 
 #endif
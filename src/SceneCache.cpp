@@ -0,0 +1,196 @@
+#include "SceneCache.h"
+#include "BVH.h"
+#include "MappedFile.h"
+#include "Renderer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+constexpr char cache_magic[8] = {'R', 'C', 'S', 'C', 'E', 'N', 'E', '\0'};
+// Início de cada seção, permite ler os vetores direto do mapeamento
+constexpr size_t section_alignment = 64;
+
+enum Section {
+    Vertices,
+    Indices,
+    TriangleMaterials,
+    Materials,
+    StoreV0x, StoreV0y, StoreV0z,
+    StoreE1x, StoreE1y, StoreE1z,
+    StoreE2x, StoreE2y, StoreE2z,
+    StoreNx, StoreNy, StoreNz,
+    StoreMaterials,
+    Nodes,
+    Lights,
+    SectionCount
+};
+
+struct CacheSection {
+    uint64_t offset = 0;
+    uint64_t count = 0;
+    uint64_t element_size = 0;
+};
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t section_count;
+    uint64_t source_hash;
+    uint32_t bvh_build; // Modo de construção da BVH guardada
+    CameraPose camera;
+    CacheSection sections[SectionCount];
+};
+
+template <typename T>
+bool read_section(const MappedFile &file, const CacheSection &section, std::vector<T> &out) {
+    if (section.element_size != sizeof(T) || section.offset % alignof(T) != 0 ||
+        section.offset + section.count * sizeof(T) > file.size()) {
+        return false;
+    }
+    const T *begin = reinterpret_cast<const T *>(file.data() + section.offset);
+    out.assign(begin, begin + section.count);
+    return true;
+}
+
+template <typename T>
+void write_section(std::ofstream &out, CacheSection &section, const std::vector<T> &data) {
+    static const char padding[section_alignment] = {};
+    const size_t position = out.tellp();
+    out.write(padding, (section_alignment - position % section_alignment) % section_alignment);
+    section.offset = out.tellp();
+    section.count = data.size();
+    section.element_size = sizeof(T);
+    out.write(reinterpret_cast<const char *>(data.data()), data.size() * sizeof(T));
+}
+
+// Seções dos triângulos empacotados, na ordem do enum a partir de StoreV0x
+template <typename Store>
+auto *store_array(Store &store, int i) {
+    decltype(&store.v0x) arrays[] = {&store.v0x, &store.v0y, &store.v0z, &store.e1x, &store.e1y, &store.e1z,
+                                    &store.e2x, &store.e2y, &store.e2z, &store.nx,  &store.ny,  &store.nz};
+    return arrays[i];
+}
+
+} // namespace
+
+// FNV-1a de 64 bits aplicado a palavras de 8 bytes, com o tamanho do arquivo misturado no início
+uint64_t SceneCache::hash_file(const char *path) {
+    const MappedFile file(path);
+    if (!file.data()) {
+        return 0;
+    }
+    const uint64_t prime = 0x100000001b3ULL;
+    uint64_t hash = (0xcbf29ce484222325ULL ^ file.size()) * prime;
+    size_t i = 0;
+    for (; i + 8 <= file.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, file.data() + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+    }
+    for (; i < file.size(); i++) {
+        hash = (hash ^ file.data()[i]) * prime;
+    }
+    return hash;
+}
+
+void Renderer::set_scene_cache(const std::string &path, uint64_t source_hash) {
+    m_cache_path = path;
+    m_cache_hash = source_hash;
+}
+
+bool Renderer::load_scene_cache(const std::string &path, uint64_t source_hash) {
+    const MappedFile file(path.c_str());
+    if (!file.data() || file.size() < sizeof(CacheHeader)) {
+        return false;
+    }
+    CacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0 || header.version != SceneCache::version ||
+        header.section_count != SectionCount || header.source_hash != source_hash ||
+        header.bvh_build != static_cast<uint32_t>(m_bvh_build)) {
+        return false;
+    }
+
+    // A forma indexada fica apenas no arquivo, a renderização usa os triângulos empacotados
+    std::vector<Color> materials;
+    TriangleStore store;
+    std::vector<BVHNode> nodes;
+    std::vector<Light> lights;
+    bool valid = read_section(file, header.sections[Materials], materials) &&
+                 read_section(file, header.sections[StoreMaterials], store.material) &&
+                 read_section(file, header.sections[Nodes], nodes) &&
+                 read_section(file, header.sections[Lights], lights);
+    for (int i = 0; valid && i < StoreMaterials - StoreV0x; i++) {
+        valid = read_section(file, header.sections[StoreV0x + i], *store_array(store, i));
+    }
+    const uint64_t triangle_count = header.sections[TriangleMaterials].count;
+    if (!valid || header.sections[Indices].count != 3 * triangle_count || store.size() != triangle_count) {
+        return false;
+    }
+
+    m_geometry.clear();
+    m_materials = std::move(materials);
+    m_material_ids.clear();
+    for (uint32_t i = 0; i < m_materials.size(); i++) {
+        m_material_ids.try_emplace(std::make_tuple(m_materials[i].r, m_materials[i].g, m_materials[i].b), i);
+    }
+    m_store = std::move(store);
+    auto bvh = std::make_unique<BVH>();
+    bvh->set_build_mode(m_bvh_build);
+    bvh->adopt(m_store, std::move(nodes));
+    m_accelerator = std::move(bvh);
+    m_lights = std::move(lights);
+    m_lights_dirty = true;
+    m_camera.set_pose(header.camera);
+
+    m_cache_path = path;
+    m_cache_hash = source_hash;
+    m_cache_loaded = true;
+    return true;
+}
+
+bool Renderer::save_scene_cache() const {
+    // A forma indexada só existe até o fim da construção que leu o arquivo de origem
+    const auto *bvh = dynamic_cast<const BVH *>(m_accelerator.get());
+    if (m_cache_path.empty() || !bvh || m_geometry.triangle_count() != m_store.size()) {
+        return false;
+    }
+
+    // Gravado em um arquivo temporário e renomeado, um cache incompleto nunca é lido
+    const std::string temp_path = m_cache_path + ".tmp";
+    std::ofstream out(temp_path, std::ios::binary);
+    if (!out) {
+        return false;
+    }
+    CacheHeader header = {};
+    std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version = SceneCache::version;
+    header.section_count = SectionCount;
+    header.source_hash = m_cache_hash;
+    header.bvh_build = static_cast<uint32_t>(bvh->get_build_mode());
+    header.camera = m_camera.get_pose();
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    write_section(out, header.sections[Vertices], m_geometry.vertices);
+    write_section(out, header.sections[Indices], m_geometry.indices);
+    write_section(out, header.sections[TriangleMaterials], m_geometry.material);
+    write_section(out, header.sections[Materials], m_materials);
+    for (int i = 0; i < StoreMaterials - StoreV0x; i++) {
+        write_section(out, header.sections[StoreV0x + i], *store_array(m_store, i));
+    }
+    write_section(out, header.sections[StoreMaterials], m_store.material);
+    write_section(out, header.sections[Nodes], bvh->nodes());
+    write_section(out, header.sections[Lights], m_lights);
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.close();
+    if (!out || std::rename(temp_path.c_str(), m_cache_path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,22 @@
+#ifndef SCENE_CACHE_H
+#define SCENE_CACHE_H
+
+#include <cstdint>
+#include <string>
+
+// Cache binário de cena gravado ao lado do arquivo de origem. Guarda a geometria indexada,
+// os materiais, os triângulos empacotados com a BVH já construída, as luzes e a câmera.
+// Cada modo de construção da BVH tem o seu cache, um cache de outro modo é refeito.
+// O arquivo é mapeado em memória e suas seções são copiadas direto para os vetores,
+// sem interpretar texto nem reconstruir a estrutura de aceleração
+namespace SceneCache {
+    // Incrementada sempre que o layout do arquivo, a leitura do .obj ou a construção da BVH mudam
+    constexpr uint32_t version = 4;
+
+    // Hash do conteúdo de um arquivo, 0 se ele não puder ser lido
+    uint64_t hash_file(const char *path);
+
+    inline std::string path_for(const char *source) { return std::string(source) + ".rcache"; }
+};
+
+#endif
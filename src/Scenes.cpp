@@ -1,9 +1,11 @@
 #include "Scenes.h"
+#include "ObjParser.h"
+#include "SceneCache.h"
+#include <chrono>
 #include <iostream>
+#include <random>
 #include <string>
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
 
 std::vector<Triangle> create_parallelepiped(
     const Vector3 &center,
@@ -98,8 +100,11 @@ void Scenes::construct_towers() {
         Color(1.0F, 1.0F, 1.0F)
     };
 
+    // As torres são instâncias de um único cubo unitário
+    const uint32_t cube = render.add_mesh(create_parallelepiped(Vector3(0.0F, 0.0F, 0.0F), 1.0F, 1.0F, 1.0F, floor_color));
     for (int i = 0; i < 4; ++i) {
-        render.add_object(create_parallelepiped(tower_pos[i], tower_w, tower_h, tower_d, tower_color[i]));
+        render.add_instance(cube, Transform::translate(tower_pos[i]) * Transform::scale({tower_w, tower_h, tower_d}),
+                            tower_color[i]);
     }
 
     Vector3 light_pos[4] = {
@@ -184,55 +189,143 @@ void Scenes::construct_walls() {
     render.set_camera(Camera({-1, -2, 6.5}, 60.0));
 }
 
-// Função para importar modelos .obj
-void Scenes::load_obj(const char* path) {
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string err;
+// lights: Salão com centenas de luzes pontuais coloridas e fortemente atenuadas,
+// cada ponto do chão é iluminado apenas pelas luzes próximas
+void Scenes::construct_lights() {
+    Renderer &render = Renderer::get_instance();
+
+    const float floor_size = 40.0F;
+    const float floor_y = -5.0F;
+    const Color floor_color(0.9F, 0.9F, 0.9F);
+
+    render.add_triangle({Vector3(-floor_size/2, floor_y, -floor_size/2),
+                        Vector3(floor_size/2, floor_y, floor_size/2),
+                        Vector3(floor_size/2, floor_y, -floor_size/2),
+                        floor_color});
+    render.add_triangle({Vector3(-floor_size/2, floor_y, -floor_size/2),
+                        Vector3(-floor_size/2, floor_y, floor_size/2),
+                        Vector3(floor_size/2, floor_y, floor_size/2),
+                        floor_color});
+
+    // Pilares em grade, entre as luzes
+    const int pillar_count = 8;
+    const float pillar_spacing = floor_size / pillar_count;
+    const float pillar_h = 2.0F;
+    for (int i = 0; i < pillar_count; ++i) {
+        for (int j = 0; j < pillar_count; ++j) {
+            const Vector3 pos(-floor_size/2 + pillar_spacing * (i + 0.5F), floor_y + pillar_h/2,
+                              -floor_size/2 + pillar_spacing * (j + 0.5F));
+            render.add_object(create_parallelepiped(pos, 0.8F, pillar_h, 0.8F, Color(0.7F, 0.7F, 0.75F)));
+        }
+    }
+
+    // 16x16 luzes em cores alternadas logo acima do chão
+    const int light_count = 16;
+    const float light_spacing = floor_size / light_count;
+    const float light_height = 0.6F;
+    const Color light_color[3] = {
+        Color(1.0F, 0.4F, 0.4F),
+        Color(0.4F, 1.0F, 0.4F),
+        Color(0.4F, 0.4F, 1.0F)
+    };
+    for (int i = 0; i < light_count; ++i) {
+        for (int j = 0; j < light_count; ++j) {
+            const Vector3 pos(-floor_size/2 + light_spacing * i, floor_y + light_height,
+                              -floor_size/2 + light_spacing * j);
+            render.add_light(Light(pos, light_color[(i + j) % 3], 30.0F));
+        }
+    }
+    render.set_camera(Camera({0.0, -1.0, 22.0}, 60.0));
+}
+
+// Lê um arquivo .obj como malha indexada. Os vértices do arquivo são compartilhados
+// pelas faces e as cores dos materiais entram na tabela de materiais do Renderer
+static IndexedMesh read_obj(const char* path) {
+    auto start = std::chrono::high_resolution_clock::now();
 
-    bool success = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, path);
+    IndexedMesh mesh;
+    std::vector<ObjParser::ObjMaterial> materials;
+    std::string err;
+    Renderer &render = Renderer::get_instance();
 
-    if (!err.empty()) {
+    if (!ObjParser::load(path, mesh, materials, err, render.get_pool())) {
         std::cout << "Erro: " << err << std::endl;
         exit(1);
     }
 
+    // Material de cada material do arquivo, e o branco para faces sem material
+    std::vector<uint32_t> material_idx;
+    for (const auto& mat : materials) {
+        material_idx.push_back(render.add_material(Color(mat.diffuse.x, mat.diffuse.y, mat.diffuse.z)));
+    }
+    const uint32_t default_material = render.add_material(Color(1, 1, 1));
+
+    for (uint32_t &material : mesh.material) {
+        material = material == ObjParser::no_material ? default_material : material_idx[material];
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+    std::cout << "Tempo de leitura (" << path << "): " << duration.count() / 1000.0 << "ms ("
+              << mesh.vertices.size() << " vértices, " << mesh.triangle_count() << " triângulos)" << std::endl;
+    return mesh;
+}
+
+// Função para importar modelos .obj. Usa o cache binário gravado ao lado do arquivo
+// quando ele corresponde ao conteúdo atual, senão lê o .obj e grava um novo cache
+void Scenes::load_obj(const char* path) {
     Renderer &render = Renderer::get_instance();
 
-    for (const auto& shape : shapes) {
-        for (size_t i = 0; i < shape.mesh.indices.size(); i += 3) {
-            Vector3 triangle_vertices[3];
-            for (int j = 0; j < 3; j++) {
-                tinyobj::index_t idx = shape.mesh.indices[i + j];
-                float x = attrib.vertices[3 * idx.vertex_index + 0];
-                float y = attrib.vertices[3 * idx.vertex_index + 1];
-                float z = attrib.vertices[3 * idx.vertex_index + 2];
-                triangle_vertices[j] = Vector3(x, y, z);
-            }
-
-            Color triangle_color(1, 1, 1);
-
-            if (!shape.mesh.material_ids.empty()) {
-                int material_id = shape.mesh.material_ids[i / 3];
-                if (material_id >= 0 && material_id < materials.size()) {
-                    const auto& mat = materials[material_id];
-                    triangle_color = Color(
-                        mat.diffuse[0],
-                        mat.diffuse[1],
-                        mat.diffuse[2]
-                    );
-                }
-            }
-
-            render.add_triangle({
-                triangle_vertices[0],
-                triangle_vertices[1],
-                triangle_vertices[2],
-                triangle_color
-            });
-        }
+    const std::string cache_path = SceneCache::path_for(path);
+    const uint64_t hash = SceneCache::hash_file(path);
+    if (hash != 0 && render.load_scene_cache(cache_path, hash)) {
+        return;
+    }
+    if (hash != 0) {
+        render.set_scene_cache(cache_path, hash);
     }
+
+    render.add_object(read_obj(path));
     render.add_light(Light({0.0, 300.0, 250.0}));
     render.set_camera(Camera({-180.0, 300.0, 500.0}, {0.0, 190.0, 0.0}, 60.0));
 }
+
+// herd: Dez mil cópias de um modelo .obj. A malha é guardada uma vez e cada cópia
+// custa apenas a sua transformação e cor
+void Scenes::construct_herd(const char* path) {
+    Renderer &render = Renderer::get_instance();
+
+    const uint32_t mesh = render.add_mesh(read_obj(path));
+
+    const int grid = 100;
+    const float spacing = 600.0F;
+    const float extent = grid * spacing;
+
+    render.add_triangle({Vector3(-extent, 0.0F, -extent), Vector3(extent, 0.0F, extent),
+                         Vector3(extent, 0.0F, -extent), Color(0.6F, 0.7F, 0.5F)});
+    render.add_triangle({Vector3(-extent, 0.0F, -extent), Vector3(-extent, 0.0F, extent),
+                         Vector3(extent, 0.0F, extent), Color(0.6F, 0.7F, 0.5F)});
+
+    // Gerador fixo para que a cena seja a mesma em toda execução
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> unit(0.0F, 1.0F);
+    const float pi = 3.14159265F;
+
+    for (int i = 0; i < grid; i++) {
+        for (int j = 0; j < grid; j++) {
+            const Vector3 pos((i - grid / 2 + unit(rng) * 0.5F) * spacing, 0.0F,
+                              (j - grid / 2 + unit(rng) * 0.5F) * spacing);
+            const float yaw = unit(rng) * 2.0F * pi;
+            const float scale = 0.7F + unit(rng) * 0.6F;
+            const Color color(0.5F + unit(rng) * 0.5F, 0.35F + unit(rng) * 0.3F, 0.2F + unit(rng) * 0.2F);
+
+            render.add_instance(mesh,
+                                Transform::translate(pos) * Transform::rotate_y(yaw) *
+                                    Transform::scale({scale, scale, scale}),
+                                color);
+        }
+    }
+
+    render.add_light(Light({0.0, 20000.0, 15000.0}));
+    render.set_camera(Camera({0.0, 3000.0, 9000.0}, {0.0, 0.0, 0.0}, 60.0));
+}
@@ -8,7 +8,9 @@ namespace Scenes {
     void construct_cubes();
     void construct_towers();
     void construct_walls();
+    void construct_lights();
     void load_obj(const char* path);
+    void construct_herd(const char* path);
 };
 
 #endif
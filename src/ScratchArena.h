@@ -0,0 +1,41 @@
+#ifndef SCRATCH_ARENA_H
+#define SCRATCH_ARENA_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Memória temporária de uma thread de renderização. O bloco é reservado fora
+// do caminho crítico e cada alocação apenas avança um deslocamento, então o
+// traçado dos raios nunca chama o alocador do sistema. Esvaziada a cada bloco da imagem
+class ScratchArena {
+  public:
+    // Garante ao menos bytes de capacidade, descartando o conteúdo atual
+    void reserve(size_t bytes) {
+        if (bytes > m_capacity) {
+            m_data = std::make_unique<std::byte[]>(bytes);
+            m_capacity = bytes;
+        }
+        m_offset = 0;
+    }
+
+    template <typename T> T *allocate(size_t count) {
+        const size_t start = (m_offset + alignof(T) - 1) & ~(alignof(T) - 1);
+        assert(start + count * sizeof(T) <= m_capacity && "ScratchArena sem capacidade");
+        m_offset = start + count * sizeof(T);
+        return reinterpret_cast<T *>(m_data.get() + start);
+    }
+
+    // Posição atual, para devolver de uma vez tudo que foi alocado depois dela
+    size_t mark() const { return m_offset; }
+    void rewind(size_t mark) { m_offset = mark; }
+    void reset() { m_offset = 0; }
+
+  private:
+    std::unique_ptr<std::byte[]> m_data;
+    size_t m_capacity = 0;
+    size_t m_offset = 0;
+};
+
+#endif
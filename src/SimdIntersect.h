@@ -0,0 +1,178 @@
+#ifndef SIMD_INTERSECT_H
+#define SIMD_INTERSECT_H
+
+#include <immintrin.h>
+
+#include "TriangleStore.h"
+
+// Kernels que testam um raio contra até 8 triângulos consecutivos do armazenamento.
+// Com AVX2 os 8 triângulos são testados de uma vez, sem ele são usadas duas passadas SSE.
+// A conta é a mesma de TriangleStore::intersect, sem FMA, para que os resultados coincidam
+
+// Interseção mais próxima do lote, index é -1 quando nenhum triângulo é atingido
+struct BatchHit {
+    int index = -1;
+    float t = INFINITY;
+};
+
+#ifdef __AVX2__
+
+// Calcula t para os 8 triângulos a partir de first, INFINITY nas faixas sem interseção válida
+inline __m256 intersect8_lanes(const TriangleStore &store, uint32_t first, uint32_t count, const Ray &ray) {
+    const __m256i lane_mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(count)),
+                                                 _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    auto load = [&](const std::vector<float> &array) { return _mm256_maskload_ps(array.data() + first, lane_mask); };
+
+    const __m256 e1x = load(store.e1x), e1y = load(store.e1y), e1z = load(store.e1z);
+    const __m256 e2x = load(store.e2x), e2y = load(store.e2y), e2z = load(store.e2z);
+    const __m256 dx = _mm256_set1_ps(ray.direction.x);
+    const __m256 dy = _mm256_set1_ps(ray.direction.y);
+    const __m256 dz = _mm256_set1_ps(ray.direction.z);
+
+    // h = direção x aresta2
+    const __m256 hx = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+    const __m256 hy = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+    const __m256 hz = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+    const __m256 det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, hx), _mm256_mul_ps(e1y, hy)),
+                                     _mm256_mul_ps(e1z, hz));
+    const __m256 f = _mm256_div_ps(_mm256_set1_ps(1.0F), det);
+
+    // s = origem - v0
+    const __m256 sx = _mm256_sub_ps(_mm256_set1_ps(ray.origin.x), load(store.v0x));
+    const __m256 sy = _mm256_sub_ps(_mm256_set1_ps(ray.origin.y), load(store.v0y));
+    const __m256 sz = _mm256_sub_ps(_mm256_set1_ps(ray.origin.z), load(store.v0z));
+    const __m256 u = _mm256_mul_ps(
+        f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, hx), _mm256_mul_ps(sy, hy)), _mm256_mul_ps(sz, hz)));
+
+    // q = s x aresta1
+    const __m256 qx = _mm256_sub_ps(_mm256_mul_ps(sy, e1z), _mm256_mul_ps(sz, e1y));
+    const __m256 qy = _mm256_sub_ps(_mm256_mul_ps(sz, e1x), _mm256_mul_ps(sx, e1z));
+    const __m256 qz = _mm256_sub_ps(_mm256_mul_ps(sx, e1y), _mm256_mul_ps(sy, e1x));
+    const __m256 v = _mm256_mul_ps(
+        f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz)));
+    const __m256 t = _mm256_mul_ps(
+        f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz)));
+
+    const __m256 epsilon = _mm256_set1_ps(0.0000001F);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0F);
+    __m256 valid = _mm256_castsi256_ps(lane_mask);
+    valid = _mm256_and_ps(valid, _mm256_or_ps(_mm256_cmp_ps(det, _mm256_sub_ps(zero, epsilon), _CMP_LE_OQ),
+                                              _mm256_cmp_ps(det, epsilon, _CMP_GE_OQ)));
+    valid = _mm256_and_ps(valid, _mm256_cmp_ps(u, zero, _CMP_GE_OQ));
+    valid = _mm256_and_ps(valid, _mm256_cmp_ps(u, one, _CMP_LE_OQ));
+    valid = _mm256_and_ps(valid, _mm256_cmp_ps(v, zero, _CMP_GE_OQ));
+    valid = _mm256_and_ps(valid, _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ));
+    valid = _mm256_and_ps(valid, _mm256_cmp_ps(t, epsilon, _CMP_GE_OQ));
+
+    return _mm256_blendv_ps(_mm256_set1_ps(INFINITY), t, valid);
+}
+
+inline BatchHit intersect8(const TriangleStore &store, uint32_t first, uint32_t count, const Ray &ray, float t_max) {
+    const __m256 t = intersect8_lanes(store, first, count, ray);
+
+    // Mínimo horizontal e primeira faixa que o contém
+    __m256 min_t = _mm256_min_ps(t, _mm256_permute2f128_ps(t, t, 1));
+    min_t = _mm256_min_ps(min_t, _mm256_shuffle_ps(min_t, min_t, _MM_SHUFFLE(1, 0, 3, 2)));
+    min_t = _mm256_min_ps(min_t, _mm256_shuffle_ps(min_t, min_t, _MM_SHUFFLE(2, 3, 0, 1)));
+    const float nearest = _mm256_cvtss_f32(min_t);
+
+    BatchHit hit;
+    if (nearest <= t_max && nearest != INFINITY) {
+        const int lanes = _mm256_movemask_ps(_mm256_cmp_ps(t, min_t, _CMP_EQ_OQ));
+        hit.index = static_cast<int>(first) + __builtin_ctz(lanes);
+        hit.t = nearest;
+    }
+    return hit;
+}
+
+inline bool occluded8(const TriangleStore &store, uint32_t first, uint32_t count, const Ray &ray, float t_max) {
+    const __m256 t = intersect8_lanes(store, first, count, ray);
+    return _mm256_movemask_ps(_mm256_cmp_ps(t, _mm256_set1_ps(t_max), _CMP_LT_OQ)) != 0;
+}
+
+#else
+
+// Versão SSE, testa 4 triângulos a partir de first
+inline __m128 intersect4_lanes(const TriangleStore &store, uint32_t first, uint32_t count, const Ray &ray) {
+    // Faixas além de count são lidas de um buffer zerado para não passar do fim dos vetores
+    auto load = [&](const std::vector<float> &array) {
+        if (count >= 4) {
+            return _mm_loadu_ps(array.data() + first);
+        }
+        alignas(16) float lanes[4] = {};
+        for (uint32_t i = 0; i < count; i++) {
+            lanes[i] = array[first + i];
+        }
+        return _mm_load_ps(lanes);
+    };
+
+    const __m128 e1x = load(store.e1x), e1y = load(store.e1y), e1z = load(store.e1z);
+    const __m128 e2x = load(store.e2x), e2y = load(store.e2y), e2z = load(store.e2z);
+    const __m128 dx = _mm_set1_ps(ray.direction.x);
+    const __m128 dy = _mm_set1_ps(ray.direction.y);
+    const __m128 dz = _mm_set1_ps(ray.direction.z);
+
+    const __m128 hx = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+    const __m128 hy = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+    const __m128 hz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+    const __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, hx), _mm_mul_ps(e1y, hy)), _mm_mul_ps(e1z, hz));
+    const __m128 f = _mm_div_ps(_mm_set1_ps(1.0F), det);
+
+    const __m128 sx = _mm_sub_ps(_mm_set1_ps(ray.origin.x), load(store.v0x));
+    const __m128 sy = _mm_sub_ps(_mm_set1_ps(ray.origin.y), load(store.v0y));
+    const __m128 sz = _mm_sub_ps(_mm_set1_ps(ray.origin.z), load(store.v0z));
+    const __m128 u = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, hx), _mm_mul_ps(sy, hy)), _mm_mul_ps(sz, hz)));
+
+    const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+    const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+    const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+    const __m128 v = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)));
+    const __m128 t = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)));
+
+    const __m128 epsilon = _mm_set1_ps(0.0000001F);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0F);
+    const __m128i lane_ids = _mm_setr_epi32(0, 1, 2, 3);
+    __m128 valid = _mm_castsi128_ps(_mm_cmplt_epi32(lane_ids, _mm_set1_epi32(static_cast<int>(count))));
+    valid = _mm_and_ps(valid, _mm_or_ps(_mm_cmple_ps(det, _mm_sub_ps(zero, epsilon)), _mm_cmpge_ps(det, epsilon)));
+    valid = _mm_and_ps(valid, _mm_cmpge_ps(u, zero));
+    valid = _mm_and_ps(valid, _mm_cmple_ps(u, one));
+    valid = _mm_and_ps(valid, _mm_cmpge_ps(v, zero));
+    valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(u, v), one));
+    valid = _mm_and_ps(valid, _mm_cmpge_ps(t, epsilon));
+
+    return _mm_or_ps(_mm_and_ps(valid, t), _mm_andnot_ps(valid, _mm_set1_ps(INFINITY)));
+}
+
+inline BatchHit intersect8(const TriangleStore &store, uint32_t first, uint32_t count, const Ray &ray, float t_max) {
+    BatchHit hit;
+    for (uint32_t offset = 0; offset < count; offset += 4) {
+        const __m128 t = intersect4_lanes(store, first + offset, std::min(count - offset, 4U), ray);
+
+        __m128 min_t = _mm_min_ps(t, _mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 0, 3, 2)));
+        min_t = _mm_min_ps(min_t, _mm_shuffle_ps(min_t, min_t, _MM_SHUFFLE(2, 3, 0, 1)));
+        const float nearest = _mm_cvtss_f32(min_t);
+
+        if (nearest < hit.t && nearest <= t_max) {
+            const int lanes = _mm_movemask_ps(_mm_cmpeq_ps(t, min_t));
+            hit.index = static_cast<int>(first + offset) + __builtin_ctz(lanes);
+            hit.t = nearest;
+        }
+    }
+    return hit;
+}
+
+inline bool occluded8(const TriangleStore &store, uint32_t first, uint32_t count, const Ray &ray, float t_max) {
+    for (uint32_t offset = 0; offset < count; offset += 4) {
+        const __m128 t = intersect4_lanes(store, first + offset, std::min(count - offset, 4U), ray);
+        if (_mm_movemask_ps(_mm_cmplt_ps(t, _mm_set1_ps(t_max))) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstdint>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// Contador usado nas medições por etapa: ciclos (rdtsc) no x86, nanossegundos do relógio
+// monotônico nas demais arquiteturas. As métricas convertem pela razão com a duração do quadro
+inline uint64_t read_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+// Etapas medidas em cada quadro. As quatro primeiras são medidas com read_cycles
+// pelas threads de renderização, a apresentação é medida pela janela
+enum class Stage { RayGeneration, Primary, Shadow, Shading, Present, Count };
+constexpr int stage_count = static_cast<int>(Stage::Count);
+
+// Contadores de trabalho da renderização. Cada thread acumula os seus
+// e o renderizador soma as diferenças ao fim de cada quadro
+struct RayCounters {
+    uint64_t primary_rays = 0;
+    uint64_t shadow_rays = 0;
+    uint64_t shadow_occluded = 0; // Shadow rays interrompidos por um triângulo
+    uint64_t node_visits = 0;     // Nós da BVH ou células da grade visitados
+    uint64_t primitive_tests = 0; // Testes raio-triângulo
+    uint64_t stage_cycles[stage_count] = {};
+
+    RayCounters &operator+=(const RayCounters &other) {
+        primary_rays += other.primary_rays;
+        shadow_rays += other.shadow_rays;
+        shadow_occluded += other.shadow_occluded;
+        node_visits += other.node_visits;
+        primitive_tests += other.primitive_tests;
+        for (int i = 0; i < stage_count; i++) {
+            stage_cycles[i] += other.stage_cycles[i];
+        }
+        return *this;
+    }
+
+    RayCounters operator-(const RayCounters &other) const {
+        RayCounters result = *this;
+        result.primary_rays -= other.primary_rays;
+        result.shadow_rays -= other.shadow_rays;
+        result.shadow_occluded -= other.shadow_occluded;
+        result.node_visits -= other.node_visits;
+        result.primitive_tests -= other.primitive_tests;
+        for (int i = 0; i < stage_count; i++) {
+            result.stage_cycles[i] -= other.stage_cycles[i];
+        }
+        return result;
+    }
+};
+
+inline thread_local RayCounters t_ray_counters;
+
+// Acumula em t_ray_counters os ciclos entre a construção e a destruição
+// ou entre chamadas de lap, que passam a contar para a etapa seguinte.
+// Um medidor aninhado informa a etapa externa, da qual o seu tempo é descontado
+class StageTimer {
+  public:
+    explicit StageTimer(Stage stage, Stage parent = Stage::Count)
+        : m_stage(stage), m_parent(parent), m_start(read_cycles()) {}
+    ~StageTimer() { lap(m_stage); }
+
+    // Encerra a etapa atual e começa a medir a próxima
+    void lap(Stage next) {
+        const uint64_t now = read_cycles();
+        t_ray_counters.stage_cycles[static_cast<int>(m_stage)] += now - m_start;
+        if (m_parent != Stage::Count) {
+            t_ray_counters.stage_cycles[static_cast<int>(m_parent)] -= now - m_start;
+        }
+        m_stage = next;
+        m_start = now;
+    }
+
+  private:
+    Stage m_stage;
+    Stage m_parent;
+    uint64_t m_start;
+};
+
+#endif
@@ -0,0 +1,164 @@
+#include "TLAS.h"
+#include "Stats.h"
+
+#include <algorithm>
+#include <numeric>
+
+void TLAS::build(const std::vector<Mesh> &meshes, std::vector<Instance> &instances) {
+    m_meshes = &meshes;
+    m_instances = &instances;
+    m_nodes.clear();
+    m_indices.resize(instances.size());
+    std::iota(m_indices.begin(), m_indices.end(), 0);
+
+    for (Instance &instance : instances) {
+        instance.bounds = instance.object_to_world.bounds(meshes[instance.mesh].bounds);
+    }
+    if (instances.empty()) {
+        return;
+    }
+
+    m_nodes.reserve(2 * instances.size() - 1);
+    m_nodes.emplace_back();
+    m_nodes[0].count = instances.size();
+    subdivide(0, 0);
+    m_nodes.shrink_to_fit();
+}
+
+void TLAS::subdivide(uint32_t node_idx, int depth) {
+    const std::vector<Instance> &instances = *m_instances;
+    const uint32_t first = m_nodes[node_idx].left_first;
+    const uint32_t count = m_nodes[node_idx].count;
+
+    AABB node_bounds;
+    AABB centroid_bounds;
+    for (uint32_t i = first; i < first + count; i++) {
+        node_bounds.grow(instances[m_indices[i]].bounds);
+        centroid_bounds.grow(instances[m_indices[i]].bounds.center());
+    }
+    m_nodes[node_idx].bounds = node_bounds;
+
+    if (count <= max_leaf_size || depth >= max_depth - 1) {
+        return;
+    }
+
+    // As instâncias costumam ter tamanhos parecidos, a divisão pela mediana no eixo
+    // de maior extensão dos centros já gera uma árvore equilibrada
+    const int axis = centroid_bounds.largest_axis();
+    const uint32_t mid = first + count / 2;
+    std::nth_element(m_indices.begin() + first, m_indices.begin() + mid, m_indices.begin() + first + count,
+                     [&](uint32_t a, uint32_t b) {
+                         return instances[a].bounds.center()[axis] < instances[b].bounds.center()[axis];
+                     });
+
+    const uint32_t left = m_nodes.size();
+    m_nodes.emplace_back();
+    m_nodes.emplace_back();
+    m_nodes[left].left_first = first;
+    m_nodes[left].count = mid - first;
+    m_nodes[left + 1].left_first = mid;
+    m_nodes[left + 1].count = first + count - mid;
+    m_nodes[node_idx].left_first = left;
+    m_nodes[node_idx].count = 0;
+
+    subdivide(left, depth + 1);
+    subdivide(left + 1, depth + 1);
+}
+
+bool TLAS::intersect(const Ray &ray, float &closest_t, int &closest_idx, int &closest_instance) const {
+    if (m_nodes.empty() || intersect_aabb(m_nodes[0].bounds, ray, closest_t) == INFINITY) {
+        return false;
+    }
+
+    const std::vector<Instance> &instances = *m_instances;
+    const std::vector<Mesh> &meshes = *m_meshes;
+    RayCounters &counters = t_ray_counters;
+    bool hit = false;
+    uint32_t stack[max_depth];
+    int stack_size = 0;
+    uint32_t node_idx = 0;
+
+    while (true) {
+        const BVHNode &node = m_nodes[node_idx];
+        counters.node_visits++;
+
+        if (node.is_leaf()) {
+            for (uint32_t i = node.left_first; i < node.left_first + node.count; i++) {
+                const Instance &instance = instances[m_indices[i]];
+                // Só aceita interseções estritamente mais próximas que a atual
+                int mesh_idx = -1;
+                if (meshes[instance.mesh].bvh.intersect(to_object(instance, ray), closest_t, mesh_idx)) {
+                    closest_idx = mesh_idx;
+                    closest_instance = m_indices[i];
+                    hit = true;
+                }
+            }
+        } else {
+            // Visita primeiro o filho mais próximo, o outro fica na pilha
+            uint32_t near_idx = node.left_first;
+            uint32_t far_idx = node.left_first + 1;
+            float near_t = intersect_aabb(m_nodes[near_idx].bounds, ray, closest_t);
+            float far_t = intersect_aabb(m_nodes[far_idx].bounds, ray, closest_t);
+            if (far_t < near_t) {
+                std::swap(near_idx, far_idx);
+                std::swap(near_t, far_t);
+            }
+
+            if (near_t != INFINITY) {
+                if (far_t != INFINITY) {
+                    stack[stack_size++] = far_idx;
+                }
+                node_idx = near_idx;
+                continue;
+            }
+        }
+
+        // Desempilha descartando nós que ficaram atrás da interseção mais próxima
+        bool found = false;
+        while (stack_size > 0) {
+            node_idx = stack[--stack_size];
+            if (intersect_aabb(m_nodes[node_idx].bounds, ray, closest_t) != INFINITY) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            break;
+        }
+    }
+    return hit;
+}
+
+bool TLAS::occluded(const Ray &ray, float t_max) const {
+    if (m_nodes.empty() || intersect_aabb(m_nodes[0].bounds, ray, t_max) == INFINITY) {
+        return false;
+    }
+
+    const std::vector<Instance> &instances = *m_instances;
+    const std::vector<Mesh> &meshes = *m_meshes;
+    RayCounters &counters = t_ray_counters;
+    uint32_t stack[max_depth];
+    int stack_size = 0;
+    stack[stack_size++] = 0;
+
+    while (stack_size > 0) {
+        const BVHNode &node = m_nodes[stack[--stack_size]];
+        counters.node_visits++;
+
+        if (node.is_leaf()) {
+            for (uint32_t i = node.left_first; i < node.left_first + node.count; i++) {
+                const Instance &instance = instances[m_indices[i]];
+                if (meshes[instance.mesh].bvh.occluded(to_object(instance, ray), t_max)) {
+                    return true;
+                }
+            }
+        } else {
+            for (uint32_t child = node.left_first; child < node.left_first + 2; child++) {
+                if (intersect_aabb(m_nodes[child].bounds, ray, t_max) != INFINITY) {
+                    stack[stack_size++] = child;
+                }
+            }
+        }
+    }
+    return false;
+}
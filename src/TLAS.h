@@ -0,0 +1,60 @@
+#ifndef TLAS_H
+#define TLAS_H
+
+#include <cstdint>
+#include <vector>
+
+#include "BVH.h"
+#include "Transform.h"
+
+// Malha compartilhada entre instâncias, com a sua própria BVH (nível inferior)
+// construída uma única vez no espaço do objeto
+struct Mesh {
+    TriangleStore store;
+    BVH bvh;
+    AABB bounds; // No espaço do objeto
+};
+
+// Cópia posicionada de uma malha. Guarda apenas a transformação, a sua inversa
+// e uma cor opcional que substitui os materiais da malha
+struct Instance {
+    uint32_t mesh = 0;
+    Transform object_to_world;
+    Transform world_to_object;
+    int material = -1; // Material que substitui o da malha, -1 mantém os materiais da malha
+    AABB bounds;       // No espaço do mundo
+};
+
+// Hierarquia de nível superior sobre as caixas das instâncias. Ao chegar em uma
+// instância o raio é levado para o espaço do objeto e percorre a BVH da malha.
+// A direção transformada não é normalizada, então t vale nos dois espaços
+class TLAS {
+  public:
+    // Calcula as caixas das instâncias e constrói a hierarquia. Malhas e instâncias
+    // devem continuar vivas, e sem realocação, enquanto a estrutura for usada
+    void build(const std::vector<Mesh> &meshes, std::vector<Instance> &instances);
+
+    bool empty() const { return m_nodes.empty(); }
+
+    // Interseção mais próxima antes de closest_t, informa a instância e o triângulo da malha
+    bool intersect(const Ray &ray, float &closest_t, int &closest_idx, int &closest_instance) const;
+
+    bool occluded(const Ray &ray, float t_max) const;
+
+  private:
+    static constexpr int max_depth = 64;
+    static constexpr uint32_t max_leaf_size = 2;
+
+    std::vector<BVHNode> m_nodes;
+    std::vector<uint32_t> m_indices; // Instâncias na ordem das folhas
+    const std::vector<Mesh> *m_meshes = nullptr;
+    const std::vector<Instance> *m_instances = nullptr;
+
+    void subdivide(uint32_t node_idx, int depth);
+
+    static Ray to_object(const Instance &instance, const Ray &ray) {
+        return Ray(instance.world_to_object.point(ray.origin), instance.world_to_object.vector(ray.direction));
+    }
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(int thread_count) {
+    if (thread_count <= 0) {
+        thread_count = std::max(1U, std::thread::hardware_concurrency());
+    }
+    m_size = thread_count;
+    m_queues = std::make_unique<WorkQueue[]>(m_size);
+
+    for (int thread = 1; thread < m_size; thread++) {
+        m_threads.emplace_back(&ThreadPool::worker_loop, this, thread);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto &thread : m_threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::dispatch(int count) {
+    if (count <= 0) {
+        return;
+    }
+
+    // O contador vem antes das filas: uma thread atrasada do lote anterior
+    // pode começar a consumir assim que a primeira fila for preenchida
+    m_pending.store(count);
+
+    // Cada thread começa com um bloco contíguo, vizinhas na imagem ficam na mesma thread
+    for (int thread = 0; thread < m_size; thread++) {
+        std::lock_guard<std::mutex> lock(m_queues[thread].mutex);
+        m_queues[thread].begin = static_cast<int>(static_cast<int64_t>(count) * thread / m_size);
+        m_queues[thread].end = static_cast<int>(static_cast<int64_t>(count) * (thread + 1) / m_size);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    process(0);
+
+    // Espera as tarefas em andamento e que nenhuma thread ainda esteja olhando as filas
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [&] { return m_pending.load() == 0 && m_busy == 0; });
+}
+
+void ThreadPool::worker_loop(int thread) {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+            if (m_stop) {
+                return;
+            }
+            seen = m_generation;
+            m_busy++;
+        }
+
+        process(thread);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busy--;
+        }
+        m_done.notify_all();
+    }
+}
+
+void ThreadPool::process(int thread) {
+    int index = 0;
+    while (pop(thread, index) || steal(thread, index)) {
+        m_invoke(m_context, index, thread);
+        if (m_pending.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_done.notify_all();
+        }
+    }
+}
+
+bool ThreadPool::pop(int thread, int &index) {
+    WorkQueue &queue = m_queues[thread];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.begin >= queue.end) {
+        return false;
+    }
+    index = queue.begin++;
+    return true;
+}
+
+bool ThreadPool::steal(int thread, int &index) {
+    for (int offset = 1; offset < m_size; offset++) {
+        WorkQueue &victim = m_queues[(thread + offset) % m_size];
+        int begin = 0;
+        int end = 0;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            const int remaining = victim.end - victim.begin;
+            if (remaining <= 0) {
+                continue;
+            }
+            // Leva a metade final, a vítima continua com as tarefas que estão à sua frente
+            const int stolen = (remaining + 1) / 2;
+            begin = victim.end - stolen;
+            end = victim.end;
+            victim.end = begin;
+        }
+
+        WorkQueue &queue = m_queues[thread];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.begin = begin + 1;
+        queue.end = end;
+        index = begin;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,70 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Conjunto persistente de threads que executa lotes de tarefas indexadas.
+// Cada thread tem sua própria fila com um intervalo contíguo de tarefas: o dono consome
+// pela frente e, quando a sua acaba, rouba metade do que resta no fim da fila de outra thread.
+// As threads ficam dormindo entre lotes, então cada quadro reaproveita as mesmas threads
+class ThreadPool {
+  public:
+    // thread_count inclui a thread que chama run, 0 usa todos os núcleos
+    explicit ThreadPool(int thread_count = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    int size() const { return m_size; }
+
+    // Executa task(índice, thread) para cada índice em [0, count) e retorna quando todas terminarem.
+    // A thread que chama participa como thread 0
+    template <typename Task>
+    void run(int count, Task &&task) {
+        m_invoke = [](void *context, int index, int thread) {
+            (*static_cast<std::remove_reference_t<Task> *>(context))(index, thread);
+        };
+        m_context = const_cast<void *>(static_cast<const void *>(&task));
+        dispatch(count);
+    }
+
+  private:
+    // Intervalo de tarefas ainda não executadas de uma thread, alinhado para evitar falso compartilhamento
+    struct alignas(64) WorkQueue {
+        std::mutex mutex;
+        int begin = 0;
+        int end = 0;
+    };
+
+    int m_size;
+    std::unique_ptr<WorkQueue[]> m_queues;
+    std::vector<std::thread> m_threads;
+
+    // Tarefa do lote atual, escrita antes de preencher as filas
+    void (*m_invoke)(void *, int, int) = nullptr;
+    void *m_context = nullptr;
+    std::atomic<int> m_pending{0};
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    uint64_t m_generation = 0;
+    int m_busy = 0;
+    bool m_stop = false;
+
+    void dispatch(int count);
+    void worker_loop(int thread);
+    void process(int thread);
+    bool pop(int thread, int &index);
+    bool steal(int thread, int &index);
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include <cmath>
+
+#include "AABB.h"
+#include "Vector3.h"
+
+// Transformação afim 3x4: a parte 3x3 (rotação e escala) seguida da translação na última coluna
+struct Transform {
+    float m[3][4] = {{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}};
+
+    static Transform translate(const Vector3 &offset) {
+        Transform t;
+        t.m[0][3] = offset.x;
+        t.m[1][3] = offset.y;
+        t.m[2][3] = offset.z;
+        return t;
+    }
+
+    static Transform scale(const Vector3 &factor) {
+        Transform t;
+        t.m[0][0] = factor.x;
+        t.m[1][1] = factor.y;
+        t.m[2][2] = factor.z;
+        return t;
+    }
+
+    // Rotação em radianos em torno do eixo Y
+    static Transform rotate_y(float angle) {
+        Transform t;
+        const float c = std::cos(angle);
+        const float s = std::sin(angle);
+        t.m[0][0] = c;
+        t.m[0][2] = s;
+        t.m[2][0] = -s;
+        t.m[2][2] = c;
+        return t;
+    }
+
+    // Composição, o resultado aplica other e depois esta transformação
+    Transform operator*(const Transform &other) const {
+        Transform t;
+        for (int row = 0; row < 3; row++) {
+            for (int col = 0; col < 4; col++) {
+                t.m[row][col] = m[row][0] * other.m[0][col] + m[row][1] * other.m[1][col] + m[row][2] * other.m[2][col] +
+                                (col == 3 ? m[row][3] : 0.0F);
+            }
+        }
+        return t;
+    }
+
+    Vector3 point(const Vector3 &p) const {
+        return {m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z + m[0][3],
+                m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z + m[1][3],
+                m[2][0] * p.x + m[2][1] * p.y + m[2][2] * p.z + m[2][3]};
+    }
+
+    Vector3 vector(const Vector3 &v) const {
+        return {m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z, m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+                m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z};
+    }
+
+    // Aplica a transposta da parte 3x3. Na inversa leva normais do objeto para o mundo
+    Vector3 transpose_vector(const Vector3 &v) const {
+        return {m[0][0] * v.x + m[1][0] * v.y + m[2][0] * v.z, m[0][1] * v.x + m[1][1] * v.y + m[2][1] * v.z,
+                m[0][2] * v.x + m[1][2] * v.y + m[2][2] * v.z};
+    }
+
+    // Inversa pela matriz adjunta, a parte 3x3 não pode ser singular
+    Transform inverse() const {
+        const float a00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+        const float a01 = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+        const float a02 = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+        const float a10 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+        const float a11 = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+        const float a12 = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+        const float a20 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+        const float a21 = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+        const float a22 = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+        const float inv_det = 1.0F / (m[0][0] * a00 + m[0][1] * a10 + m[0][2] * a20);
+
+        Transform t;
+        const float adj[3][3] = {{a00, a01, a02}, {a10, a11, a12}, {a20, a21, a22}};
+        for (int row = 0; row < 3; row++) {
+            for (int col = 0; col < 3; col++) {
+                t.m[row][col] = adj[row][col] * inv_det;
+            }
+        }
+        const Vector3 offset = t.vector(Vector3(m[0][3], m[1][3], m[2][3]));
+        t.m[0][3] = -offset.x;
+        t.m[1][3] = -offset.y;
+        t.m[2][3] = -offset.z;
+        return t;
+    }
+
+    // Caixa que envolve a caixa transformada, pelos seus 8 cantos. Cada canto é alargado pelo
+    // limite do arredondamento de point, γ(3) vezes a soma dos termos em módulo (PBRT 3ª ed.,
+    // seção 3.9.4), para que a caixa da instância nunca fique menor que a geometria transformada
+    AABB bounds(const AABB &box) const {
+        constexpr float gamma3 = (3.0F * 0x1p-24F) / (1.0F - 3.0F * 0x1p-24F);
+        AABB result;
+        for (int corner = 0; corner < 8; corner++) {
+            const Vector3 p(corner & 1 ? box.max.x : box.min.x, corner & 2 ? box.max.y : box.min.y,
+                            corner & 4 ? box.max.z : box.min.z);
+            const Vector3 q = point(p);
+            Vector3 error;
+            for (int row = 0; row < 3; row++) {
+                error[row] = gamma3 * (std::abs(m[row][0] * p.x) + std::abs(m[row][1] * p.y) +
+                                       std::abs(m[row][2] * p.z) + std::abs(m[row][3]));
+            }
+            result.grow(q - error);
+            result.grow(q + error);
+        }
+        return result;
+    }
+};
+
+#endif
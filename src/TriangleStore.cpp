@@ -0,0 +1,72 @@
+#include "TriangleStore.h"
+
+template <typename T>
+static void reorder_array(std::vector<T> &array, const std::vector<uint32_t> &order) {
+    std::vector<T> reordered(order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        reordered[i] = array[order[i]];
+    }
+    array.swap(reordered);
+}
+
+void TriangleStore::clear() {
+    for (auto *array : {&v0x, &v0y, &v0z, &e1x, &e1y, &e1z, &e2x, &e2y, &e2z, &nx, &ny, &nz}) {
+        array->clear();
+    }
+    material.clear();
+}
+
+void TriangleStore::reserve(size_t count) {
+    for (auto *array : {&v0x, &v0y, &v0z, &e1x, &e1y, &e1z, &e2x, &e2y, &e2z, &nx, &ny, &nz}) {
+        array->reserve(count);
+    }
+    material.reserve(count);
+}
+
+void TriangleStore::push_back(const Vector3 &v0, const Vector3 &v1, const Vector3 &v2, uint32_t material_idx) {
+    const Vector3 edge1 = v1 - v0;
+    const Vector3 edge2 = v2 - v0;
+    const Vector3 n = edge1.cross(edge2).normalized();
+
+    v0x.push_back(v0.x);
+    v0y.push_back(v0.y);
+    v0z.push_back(v0.z);
+    e1x.push_back(edge1.x);
+    e1y.push_back(edge1.y);
+    e1z.push_back(edge1.z);
+    e2x.push_back(edge2.x);
+    e2y.push_back(edge2.y);
+    e2z.push_back(edge2.z);
+    nx.push_back(n.x);
+    ny.push_back(n.y);
+    nz.push_back(n.z);
+    material.push_back(material_idx);
+}
+
+void TriangleStore::assign(const IndexedMesh &mesh) {
+    clear();
+    append(mesh);
+}
+
+void TriangleStore::append(const IndexedMesh &mesh) {
+    reserve(size() + mesh.triangle_count());
+    for (size_t i = 0; i < mesh.triangle_count(); i++) {
+        push_back(mesh.vertex(i, 0), mesh.vertex(i, 1), mesh.vertex(i, 2), mesh.material[i]);
+    }
+}
+
+void TriangleStore::reorder(const std::vector<uint32_t> &order) {
+    for (auto *array : {&v0x, &v0y, &v0z, &e1x, &e1y, &e1z, &e2x, &e2y, &e2z, &nx, &ny, &nz}) {
+        reorder_array(*array, order);
+    }
+    reorder_array(material, order);
+}
+
+AABB TriangleStore::bounds(uint32_t i) const {
+    const Vector3 v0(v0x[i], v0y[i], v0z[i]);
+    AABB box;
+    box.grow(v0);
+    box.grow(v0 + Vector3(e1x[i], e1y[i], e1z[i]));
+    box.grow(v0 + Vector3(e2x[i], e2y[i], e2z[i]));
+    return box;
+}
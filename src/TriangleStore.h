@@ -0,0 +1,69 @@
+#ifndef TRIANGLE_STORE_H
+#define TRIANGLE_STORE_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "AABB.h"
+#include "IndexedMesh.h"
+#include "Ray.h"
+
+// Triângulos empacotados em estrutura de arrays (SoA) para os testes de interseção.
+// Arestas e normal são pré-calculadas e a cor fica fora, referenciada por um índice
+// de material, assim os laços de interseção leem apenas a geometria que utilizam
+struct TriangleStore {
+    std::vector<float> v0x, v0y, v0z;
+    std::vector<float> e1x, e1y, e1z; // v1 - v0
+    std::vector<float> e2x, e2y, e2z; // v2 - v0
+    std::vector<float> nx, ny, nz;    // Normal unitária, sem sentido definido
+    std::vector<uint32_t> material;
+
+    size_t size() const { return v0x.size(); }
+
+    void clear();
+    void reserve(size_t count);
+    void push_back(const Vector3 &v0, const Vector3 &v1, const Vector3 &v2, uint32_t material_idx);
+
+    // Substitui o conteúdo pelos triângulos de uma malha indexada, na mesma ordem
+    void assign(const IndexedMesh &mesh);
+    // Acrescenta os triângulos de uma malha indexada depois dos atuais
+    void append(const IndexedMesh &mesh);
+
+    // Reordena os triângulos, o triângulo order[i] passa a ocupar a posição i
+    void reorder(const std::vector<uint32_t> &order);
+
+    AABB bounds(uint32_t i) const;
+    Vector3 normal(uint32_t i) const { return {nx[i], ny[i], nz[i]}; }
+
+    // Möller–Trumbore com as arestas pré-calculadas, retorna INFINITY caso não haja interseção
+    float intersect(uint32_t i, const Ray &ray) const {
+        const float epsilon = 0.0000001;
+        const Vector3 edge1(e1x[i], e1y[i], e1z[i]);
+        const Vector3 edge2(e2x[i], e2y[i], e2z[i]);
+        const Vector3 h = ray.direction.cross(edge2);
+        const float det = edge1.dot(h);
+
+        if (det > -epsilon && det < epsilon) {
+            return INFINITY;
+        }
+
+        const float f = 1.0F / det;
+        const Vector3 s = ray.origin - Vector3(v0x[i], v0y[i], v0z[i]);
+        const float u = f * s.dot(h);
+        if (u < 0.0F || u > 1.0F) {
+            return INFINITY;
+        }
+
+        const Vector3 q = s.cross(edge1);
+        const float v = f * ray.direction.dot(q);
+        if (v < 0.0F || u + v > 1.0F) {
+            return INFINITY;
+        }
+
+        const float t = f * edge2.dot(q);
+        return t < epsilon ? INFINITY : t;
+    }
+};
+
+#endif
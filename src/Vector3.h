@@ -1,3 +1,6 @@
+#ifndef VECTOR3_H
+#define VECTOR3_H
+
 #include <cmath>
 
 // Classe para representar vetores e pontos
@@ -15,6 +18,10 @@ struct Vector3 {
 
     Vector3 operator/(float scalar) const { return {x / scalar, y / scalar, z / scalar}; }
 
+    // Acesso por eixo (0 = x, 1 = y, 2 = z)
+    float operator[](int axis) const { return axis == 0 ? x : (axis == 1 ? y : z); }
+    float &operator[](int axis) { return axis == 0 ? x : (axis == 1 ? y : z); }
+
     float dot(const Vector3 &other) const { return (x * other.x) + (y * other.y) + (z * other.z); }
 
     Vector3 cross(const Vector3 &other) const {
@@ -31,3 +38,5 @@ struct Vector3 {
         return *this;
     }
 };
+
+#endif
@@ -0,0 +1,267 @@
+#include "WideBVH.h"
+#include "SimdIntersect.h"
+#include "Stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+WideNode::WideNode() {
+    for (int i = 0; i < wide_width; i++) {
+        for (int axis = 0; axis < 3; axis++) {
+            bounds[axis][i] = INFINITY;
+            bounds[3 + axis][i] = -INFINITY;
+        }
+        child[i] = 0;
+        count[i] = 0;
+    }
+}
+
+namespace {
+
+// Filho atingido à espera de ser percorrido
+struct WideEntry {
+    uint32_t child;
+    uint32_t count; // 0 para nós internos
+    float t;        // Distância de entrada na caixa
+};
+
+// Raio preparado para os testes de slab: origem e inverso da direção replicados em todas
+// as faixas e, por eixo, qual plano da caixa é atingido primeiro segundo o sinal da direção.
+// Com os planos escolhidos pelo sinal não há min/max entre as distâncias de cada eixo e as
+// caixas invertidas dos filhos vazios nunca são atingidas
+struct WideRay {
+#ifdef __AVX2__
+    __m256 origin[3];
+    __m256 inv_direction[3];
+#else
+    __m128 origin[3];
+    __m128 inv_direction[3];
+#endif
+    int near_plane[3];
+    int far_plane[3];
+
+    explicit WideRay(const Ray &ray) {
+        for (int axis = 0; axis < 3; axis++) {
+#ifdef __AVX2__
+            origin[axis] = _mm256_set1_ps(ray.origin[axis]);
+            inv_direction[axis] = _mm256_set1_ps(ray.inv_direction[axis]);
+#else
+            origin[axis] = _mm_set1_ps(ray.origin[axis]);
+            inv_direction[axis] = _mm_set1_ps(ray.inv_direction[axis]);
+#endif
+            const bool negative = std::signbit(ray.inv_direction[axis]);
+            near_plane[axis] = negative ? 3 + axis : axis;
+            far_plane[axis] = negative ? axis : 3 + axis;
+        }
+    }
+};
+
+// Testa o raio contra as caixas de todos os filhos do nó. Escreve a distância de entrada
+// de cada filho em t_near e retorna a máscara dos filhos atingidos antes de t_max.
+// A distância candidata é o primeiro operando de max/min, que retornam o segundo quando
+// há NaN (0 * infinito numa face alinhada ao raio), assim o eixo é ignorado como no teste escalar.
+// As distâncias de saída e t_max são alargadas por slab_far_scale, como em intersect_aabb
+inline int intersect_children(const WideNode &node, const WideRay &ray, float t_max, float *t_near) {
+#ifdef __AVX2__
+    __m256 near_t = _mm256_setzero_ps();
+    __m256 far_t = _mm256_set1_ps(t_max * slab_far_scale);
+    const __m256 far_scale = _mm256_set1_ps(slab_far_scale);
+    for (int axis = 0; axis < 3; axis++) {
+        const __m256 near_dist = _mm256_sub_ps(_mm256_load_ps(node.bounds[ray.near_plane[axis]]), ray.origin[axis]);
+        const __m256 far_dist = _mm256_sub_ps(_mm256_load_ps(node.bounds[ray.far_plane[axis]]), ray.origin[axis]);
+        near_t = _mm256_max_ps(_mm256_mul_ps(near_dist, ray.inv_direction[axis]), near_t);
+        far_t = _mm256_min_ps(_mm256_mul_ps(_mm256_mul_ps(far_dist, ray.inv_direction[axis]), far_scale), far_t);
+    }
+    _mm256_storeu_ps(t_near, near_t);
+    return _mm256_movemask_ps(_mm256_cmp_ps(near_t, far_t, _CMP_LE_OQ));
+#else
+    __m128 near_t = _mm_setzero_ps();
+    __m128 far_t = _mm_set1_ps(t_max * slab_far_scale);
+    const __m128 far_scale = _mm_set1_ps(slab_far_scale);
+    for (int axis = 0; axis < 3; axis++) {
+        const __m128 near_dist = _mm_sub_ps(_mm_load_ps(node.bounds[ray.near_plane[axis]]), ray.origin[axis]);
+        const __m128 far_dist = _mm_sub_ps(_mm_load_ps(node.bounds[ray.far_plane[axis]]), ray.origin[axis]);
+        near_t = _mm_max_ps(_mm_mul_ps(near_dist, ray.inv_direction[axis]), near_t);
+        far_t = _mm_min_ps(_mm_mul_ps(_mm_mul_ps(far_dist, ray.inv_direction[axis]), far_scale), far_t);
+    }
+    _mm_storeu_ps(t_near, near_t);
+    return _mm_movemask_ps(_mm_cmple_ps(near_t, far_t));
+#endif
+}
+
+} // namespace
+
+void WideBVH::build(TriangleStore &store, ThreadPool &pool) {
+    m_store = &store;
+    m_nodes.clear();
+
+    // A BVH binária reordena os triângulos na ordem das folhas, que a árvore larga mantém
+    BVH binary;
+    binary.set_build_mode(m_mode);
+    binary.build(store, pool);
+    m_sah_cost = binary.sah_cost();
+    if (binary.nodes().empty()) {
+        return;
+    }
+
+    // Cada nó largo substitui pelo menos um nível da árvore binária
+    m_nodes.reserve(binary.nodes().size() / 2 + 1);
+    collapse(binary.nodes(), 0);
+    m_nodes.shrink_to_fit();
+}
+
+uint32_t WideBVH::collapse(const std::vector<BVHNode> &binary, uint32_t binary_idx) {
+    const uint32_t node_idx = m_nodes.size();
+    m_nodes.emplace_back();
+
+    // Parte dos filhos do nó binário e abre o filho interno de maior área até ocupar todas as faixas
+    uint32_t children[wide_width];
+    int child_count = 0;
+    if (binary[binary_idx].is_leaf()) {
+        children[child_count++] = binary_idx;
+    } else {
+        children[child_count++] = binary[binary_idx].left_first;
+        children[child_count++] = binary[binary_idx].left_first + 1;
+    }
+    while (child_count < wide_width) {
+        int largest = -1;
+        float largest_area = -1.0F;
+        for (int i = 0; i < child_count; i++) {
+            const BVHNode &child = binary[children[i]];
+            if (!child.is_leaf() && child.bounds.surface_area() > largest_area) {
+                largest = i;
+                largest_area = child.bounds.surface_area();
+            }
+        }
+        if (largest == -1) {
+            break;
+        }
+        const uint32_t left_idx = binary[children[largest]].left_first;
+        children[largest] = left_idx;
+        children[child_count++] = left_idx + 1;
+    }
+
+    for (int i = 0; i < child_count; i++) {
+        const BVHNode &child = binary[children[i]];
+        // O vetor de nós cresce na recursão, o nó é acessado pelo índice
+        const uint32_t target = child.is_leaf() ? child.left_first : collapse(binary, children[i]);
+        WideNode &node = m_nodes[node_idx];
+        for (int axis = 0; axis < 3; axis++) {
+            node.bounds[axis][i] = child.bounds.min[axis];
+            node.bounds[3 + axis][i] = child.bounds.max[axis];
+        }
+        node.child[i] = target;
+        node.count[i] = child.count;
+    }
+    return node_idx;
+}
+
+bool WideBVH::intersect(const Ray &ray, float &closest_t, int &closest_idx) const {
+    if (m_nodes.empty()) {
+        return false;
+    }
+
+    const TriangleStore &store = *m_store;
+    RayCounters &counters = t_ray_counters;
+    const WideRay wide_ray(ray);
+    const int start_idx = closest_idx;
+    WideEntry stack[stack_size];
+    int stack_top = 0;
+    WideEntry entry = {0, 0, 0.0F};
+
+    while (true) {
+        if (entry.count > 0) {
+            counters.primitive_tests += entry.count;
+            for (uint32_t i = 0; i < entry.count; i += 8) {
+                const BatchHit hit = intersect8(store, entry.child + i, std::min(entry.count - i, 8U), ray, closest_t);
+                // Em caso de empate mantém o menor índice, como na varredura linear
+                if (hit.index != -1 && (hit.t < closest_t || hit.index < closest_idx)) {
+                    closest_t = hit.t;
+                    closest_idx = hit.index;
+                }
+            }
+        } else {
+            const WideNode &node = m_nodes[entry.child];
+            counters.node_visits++;
+            alignas(32) float t_near[wide_width];
+            int mask = intersect_children(node, wide_ray, closest_t, t_near);
+
+            // Filhos atingidos em ordem decrescente de distância, o mais próximo é percorrido
+            // em seguida e os demais são empilhados para sair do mais próximo ao mais distante
+            WideEntry hits[wide_width];
+            int hit_count = 0;
+            while (mask != 0) {
+                const int i = __builtin_ctz(mask);
+                mask &= mask - 1;
+                const WideEntry hit = {node.child[i], node.count[i], t_near[i]};
+                int j = hit_count++;
+                for (; j > 0 && hits[j - 1].t < hit.t; j--) {
+                    hits[j] = hits[j - 1];
+                }
+                hits[j] = hit;
+            }
+            if (hit_count > 0) {
+                for (int i = 0; i < hit_count - 1; i++) {
+                    stack[stack_top++] = hits[i];
+                }
+                entry = hits[hit_count - 1];
+                continue;
+            }
+        }
+
+        // Desempilha descartando filhos que ficaram atrás da interseção mais próxima,
+        // com a mesma folga do teste de slab para manter os empates
+        bool found = false;
+        while (stack_top > 0) {
+            entry = stack[--stack_top];
+            if (entry.t <= closest_t * slab_far_scale) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            break;
+        }
+    }
+
+    return closest_idx != start_idx;
+}
+
+bool WideBVH::occluded(const Ray &ray, float t_max) const {
+    if (m_nodes.empty()) {
+        return false;
+    }
+
+    const TriangleStore &store = *m_store;
+    RayCounters &counters = t_ray_counters;
+    const WideRay wide_ray(ray);
+    WideEntry stack[stack_size];
+    int stack_top = 0;
+    stack[stack_top++] = {0, 0, 0.0F};
+
+    // Qualquer bloqueador serve, os filhos são empilhados sem ordenar
+    while (stack_top > 0) {
+        const WideEntry entry = stack[--stack_top];
+        if (entry.count > 0) {
+            for (uint32_t i = 0; i < entry.count; i += 8) {
+                counters.primitive_tests += std::min(entry.count - i, 8U);
+                if (occluded8(store, entry.child + i, std::min(entry.count - i, 8U), ray, t_max)) {
+                    return true;
+                }
+            }
+            continue;
+        }
+
+        const WideNode &node = m_nodes[entry.child];
+        counters.node_visits++;
+        alignas(32) float t_near[wide_width];
+        int mask = intersect_children(node, wide_ray, t_max, t_near);
+        while (mask != 0) {
+            const int i = __builtin_ctz(mask);
+            mask &= mask - 1;
+            stack[stack_top++] = {node.child[i], node.count[i], t_near[i]};
+        }
+    }
+
+    return false;
+}
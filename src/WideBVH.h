@@ -0,0 +1,60 @@
+#ifndef WIDE_BVH_H
+#define WIDE_BVH_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Accelerator.h"
+#include "BVH.h"
+
+// Filhos por nó da BVH larga: 8 com AVX2, quando um nó inteiro é testado numa instrução
+// de 256 bits, e 4 com SSE
+#ifdef __AVX2__
+constexpr int wide_width = 8;
+#else
+constexpr int wide_width = 4;
+#endif
+
+// Nó da BVH larga com as caixas dos filhos em SoA, uma faixa SIMD por filho.
+// Filhos vazios têm caixas invertidas e infinitas, que nenhum raio atinge
+struct alignas(32) WideNode {
+    float bounds[6][wide_width]; // min x, y, z e max x, y, z de cada filho
+    uint32_t child[wide_width];  // Índice do nó filho ou primeiro triângulo da folha
+    uint32_t count[wide_width];  // Triângulos da folha, 0 para nós internos
+
+    WideNode();
+};
+
+// BVH de 4 ou 8 filhos por nó obtida colapsando a BVH binária. Cada visita testa o raio
+// contra as caixas de todos os filhos com um único teste de slab SIMD e os filhos atingidos
+// são percorridos do mais próximo para o mais distante. As folhas são intervalos do
+// armazenamento de triângulos, testados pelos kernels de SimdIntersect.h
+class WideBVH : public Accelerator {
+  public:
+    const char *name() const override { return wide_width == 8 ? "BVH8" : "BVH4"; }
+
+    // A BVH binária é construída no modo escolhido e descartada depois do colapso
+    void set_build_mode(BVHBuildMode mode) { m_mode = mode; }
+
+    void build(TriangleStore &store, ThreadPool &pool) override;
+    bool intersect(const Ray &ray, float &closest_t, int &closest_idx) const override;
+    bool occluded(const Ray &ray, float t_max) const override;
+
+    // Custo SAH da BVH binária que originou a árvore
+    float sah_cost() const { return m_sah_cost; }
+
+  private:
+    // Profundidade máxima herdada da BVH binária, cada visita empilha até wide_width - 1 filhos
+    static constexpr int max_depth = 64;
+    static constexpr int stack_size = max_depth * (wide_width - 1) + 1;
+
+    BVHBuildMode m_mode = BVHBuildMode::Quality;
+    std::vector<WideNode> m_nodes;
+    float m_sah_cost = 0.0F;
+    const TriangleStore *m_store = nullptr;
+
+    // Cria o nó largo equivalente ao nó binário e aos seus descendentes, retorna o seu índice
+    uint32_t collapse(const std::vector<BVHNode> &binary, uint32_t binary_idx);
+};
+
+#endif
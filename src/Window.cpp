@@ -0,0 +1,293 @@
+#include "Renderer.h"
+
+#define GL_GLEXT_PROTOTYPES
+#include <GL/glut.h>
+#include <cstring>
+
+// Parte do renderizador que depende do GLUT/OpenGL, fica fora do executável headless.
+// A thread do GLUT apenas repassa a entrada e apresenta quadros, os raios são traçados
+// em uma thread de renderização própria que publica cada quadro pronto em m_frames
+
+// Inicializa o renderizador com o cenário presente
+void Renderer::init(int argc, char **argv) {
+    glutInit(&argc, argv);
+    glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE);
+    glutInitWindowSize(m_window_width, m_window_height);
+    glutCreateWindow("Raycast");
+
+    // Register static wrapper functions
+    glutDisplayFunc(display_wrapper);
+    glutKeyboardFunc(keyboard_wrapper);
+    glutSpecialFunc(special_keys_wrapper);
+    glutTimerFunc(present_poll_ms, present_poll_wrapper, 0);
+
+    glClearColor(0.0F, 0.0F, 0.0F, 1.0F);
+    glPointSize(1.0F);
+
+    // Upload da imagem por pixel buffer objects quando disponíveis (OpenGL 2.1)
+    if (glutExtensionSupported("GL_ARB_pixel_buffer_object")) {
+        glGenBuffers(2, m_pbo);
+    }
+
+    // O primeiro quadro é pedido antes da thread começar
+    m_frame_requested = true;
+    m_render_thread = std::thread([this] { render_loop(); });
+
+    glutMainLoop();
+}
+
+void Renderer::display_wrapper() { Renderer::get_instance().present(); }
+void Renderer::keyboard_wrapper(unsigned char key, int /*x*/, int /*y*/) {
+    // Sair é tratado na thread do GLUT, o destrutor encerra a thread de renderização
+    if (key == 27) {
+        exit(0);
+    }
+    Renderer::get_instance().post_key({key, false});
+}
+void Renderer::special_keys_wrapper(int key, int /*x*/, int /*y*/) {
+    Renderer::get_instance().post_key({key, true});
+}
+void Renderer::present_poll_wrapper(int /*value*/) { Renderer::get_instance().present_poll(); }
+
+// Repassa uma tecla para a thread de renderização
+void Renderer::post_key(KeyEvent event) {
+    {
+        std::lock_guard<std::mutex> lock(m_input_mutex);
+        m_key_events.push_back(event);
+    }
+    m_input_cv.notify_one();
+}
+
+// Pede a apresentação quando a thread de renderização publicou um quadro novo. Roda na
+// thread do GLUT e não toca no estado da thread de renderização, apenas no buffer triplo
+void Renderer::present_poll() {
+    if (m_frames.fresh()) {
+        glutPostRedisplay();
+    }
+    glutTimerFunc(present_poll_ms, present_poll_wrapper, 0);
+}
+
+// Desenha o quadro publicado mais recente, sem esperar pela renderização
+void Renderer::present() {
+    const auto start = std::chrono::steady_clock::now();
+    const Frame &frame = m_frames.front();
+
+    glClear(GL_COLOR_BUFFER_BIT);
+    if (frame.width > 0) {
+        if (m_pbo[0] != 0) {
+            // Alterna entre dois buffers e descarta o conteúdo anterior antes de mapear,
+            // assim a cópia não espera o driver terminar de ler o quadro anterior
+            const GLsizeiptr size = frame.pixels.size();
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo[m_pbo_index]);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+            if (void *mapped = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY)) {
+                std::memcpy(mapped, frame.pixels.data(), size);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                glDrawPixels(frame.width, frame.height, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+            }
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            m_pbo_index = 1 - m_pbo_index;
+        } else {
+            glDrawPixels(frame.width, frame.height, GL_RGB, GL_UNSIGNED_BYTE, frame.pixels.data());
+        }
+
+        // Sobreposição de métricas, uma linha de texto por \n a partir do topo
+        const int line_height = 15;
+        int line = 1;
+        glColor3f(1.0F, 1.0F, 0.0F);
+        glWindowPos2i(8, frame.height - line * line_height);
+        for (const char *c = frame.overlay; *c != '\0'; c++) {
+            if (*c == '\n') {
+                glWindowPos2i(8, frame.height - ++line * line_height);
+            } else {
+                glutBitmapCharacter(GLUT_BITMAP_8_BY_13, *c);
+            }
+        }
+        glWindowPos2i(0, 0);
+    }
+    glutSwapBuffers();
+
+    const auto duration = std::chrono::steady_clock::now() - start;
+    m_metrics.set_present_time(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+}
+
+// Laço da thread de renderização. Espera teclas, pedidos de quadro ou o momento
+// da próxima passada progressiva, aplica a entrada e publica o quadro calculado
+void Renderer::render_loop() {
+    std::vector<KeyEvent> keys;
+    std::unique_lock<std::mutex> lock(m_input_mutex);
+    while (true) {
+        auto has_work = [&] { return m_stop_render || m_frame_requested || !m_key_events.empty(); };
+        if (m_progressive_step > 1) {
+            const auto refine_at = std::max(m_refine_at, m_last_input + std::chrono::milliseconds(progressive_delay_ms));
+            m_input_cv.wait_until(lock, refine_at, has_work);
+        } else {
+            m_input_cv.wait(lock, has_work);
+        }
+        if (m_stop_render) {
+            return;
+        }
+        keys.swap(m_key_events);
+        m_redraw = m_frame_requested;
+        m_frame_requested = false;
+        lock.unlock();
+
+        for (const KeyEvent &event : keys) {
+            if (event.special) {
+                special_keys(event.key, 0, 0);
+            } else {
+                keyboard(static_cast<unsigned char>(event.key), 0, 0);
+            }
+        }
+        keys.clear();
+        refine();
+
+        if (m_redraw) {
+            render_frame();
+
+            Frame &frame = m_frames.back();
+            frame.width = m_window_width;
+            frame.height = m_window_height;
+            frame.pixels.assign(m_pixel_buffer.begin(), m_pixel_buffer.end());
+            if (m_overlay) {
+                m_metrics.format_overlay(frame.overlay, sizeof(frame.overlay));
+            } else {
+                frame.overlay[0] = '\0';
+            }
+            m_frames.publish();
+
+            m_refine_at = std::chrono::steady_clock::now() + std::chrono::milliseconds(progressive_delay_ms);
+        }
+        lock.lock();
+    }
+}
+
+// Invalida a imagem após um movimento da câmera, no modo progressivo
+// a próxima passada volta a ser grosseira
+void Renderer::camera_moved() {
+    invalidate_image();
+    if (m_progressive) {
+        m_progressive_step = progressive_start_step;
+    }
+    m_last_input = std::chrono::steady_clock::now();
+    m_redraw = true;
+}
+
+// Dobra a resolução das amostras quando não há entrada há progressive_delay_ms
+// e a passada anterior foi apresentada há pelo menos esse tempo
+void Renderer::refine() {
+    if (m_progressive_step <= 1) {
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now < m_refine_at || now - m_last_input < std::chrono::milliseconds(progressive_delay_ms)) {
+        return;
+    }
+
+    m_progressive_step /= 2;
+    m_redraw = true;
+}
+
+void Renderer::keyboard(unsigned char key, int /*x*/, int /*y*/) {
+    const float speed = 0.1F;
+    switch (key) {
+    case 'w':
+    case 'W':
+        m_camera.move(0, 0, speed);
+        camera_moved();
+        break;
+    case 's':
+    case 'S':
+        m_camera.move(0, 0, -speed);
+        camera_moved();
+        break;
+    case 'a':
+    case 'A':
+        m_camera.move(-speed, 0, 0);
+        camera_moved();
+        break;
+    case 'd':
+    case 'D':
+        m_camera.move(speed, 0, 0);
+        camera_moved();
+        break;
+    case 'q':
+    case 'Q':
+        m_camera.move(0, speed, 0);
+        camera_moved();
+        break;
+    case 'e':
+    case 'E':
+        m_camera.move(0, -speed, 0);
+        camera_moved();
+        break;
+    case 'p':
+    case 'P':
+        // Ao alternar o modo a imagem atual é completada na resolução total
+        m_progressive = !m_progressive;
+        m_progressive_step = 1;
+        m_redraw = true;
+        break;
+    case 'h':
+    case 'H':
+        // Alterna entre os modos do mapa de calor, voltando à imagem sombreada
+        set_heatmap(static_cast<HeatmapMode>((static_cast<int>(m_heatmap) + 1) % 5));
+        std::cout << "Mapa de calor: " << heatmap_name(m_heatmap) << std::endl;
+        m_redraw = true;
+        break;
+    case 'm':
+    case 'M':
+        m_overlay = !m_overlay;
+        m_redraw = true;
+        break;
+    // Ajustes de iluminação, reaproveitam o G-buffer
+    case '+':
+        m_ambient = std::min(1.0F, m_ambient + 0.05F);
+        m_redraw = true;
+        break;
+    case '-':
+        m_ambient = std::max(0.0F, m_ambient - 0.05F);
+        m_redraw = true;
+        break;
+    case 'l':
+    case 'L':
+        if (!m_lights.empty()) {
+            m_selected_light = (m_selected_light + 1) % m_lights.size();
+            std::cout << "Luz selecionada: " << m_selected_light << std::endl;
+        }
+        break;
+    case '[':
+    case ']':
+        if (!m_lights.empty()) {
+            Light light = m_lights[m_selected_light];
+            light.attenuation_factor = std::max(0.0F, light.attenuation_factor + (key == ']' ? 0.05F : -0.05F));
+            set_light(m_selected_light, light);
+            std::cout << "Luz " << m_selected_light << ": atenuação " << light.attenuation_factor << std::endl;
+            m_redraw = true;
+        }
+        break;
+    }
+}
+
+void Renderer::special_keys(int key, int /*x*/, int /*y*/) {
+    const float speed = 0.05F;
+    switch (key) {
+    case GLUT_KEY_LEFT:
+        m_camera.rotate(speed, 0);
+        camera_moved();
+        break;
+    case GLUT_KEY_RIGHT:
+        m_camera.rotate(-speed, 0);
+        camera_moved();
+        break;
+    case GLUT_KEY_UP:
+        m_camera.rotate(0, speed);
+        camera_moved();
+        break;
+    case GLUT_KEY_DOWN:
+        m_camera.rotate(0, -speed);
+        camera_moved();
+        break;
+    }
+}
@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Renderer.h"
+#include "Scenes.h"
+
+// Driver de benchmark: renderiza cada cena em resoluções e poses de câmera fixas,
+// descarta os quadros de aquecimento e mede os demais. Os resultados saem em JSON
+// e/ou CSV para comparação entre commits e máquinas
+
+struct BenchScene {
+    std::string name;
+    std::function<void()> construct;
+};
+
+// Pose relativa à câmera definida pela cena
+struct BenchPose {
+    const char *name;
+    float yaw, pitch;
+    float dx, dy, dz;
+};
+
+struct BenchResult {
+    std::string scene;
+    std::string pose;
+    int width, height;
+    size_t triangles;
+    double build_ms;
+    float sah_cost; // Qualidade da BVH, 0 para a grade
+    double min_ms, median_ms, p95_ms;
+    double mrays_per_s;
+    RayCounters counters; // Trabalho de um quadro, igual em todos os quadros medidos
+};
+
+static const BenchPose poses[] = {
+    {"default", 0.0F, 0.0F, 0.0F, 0.0F, 0.0F},
+    {"orbit", 0.35F, -0.15F, 0.5F, 0.0F, -0.5F},
+};
+
+static void print_usage(const char *program) {
+    std::cout << "Uso: " << program << " [opções]" << std::endl;
+    std::cout << "Opções:" << std::endl;
+    std::cout << "  --warmup <N>       - Quadros de aquecimento descartados (padrão: 2)" << std::endl;
+    std::cout << "  --frames <M>       - Quadros medidos (padrão: 10)" << std::endl;
+    std::cout << "  --size <LxA>       - Resolução, pode ser repetida (padrão: 640x480 e 1280x720)" << std::endl;
+    std::cout << "  --obj <arquivo>    - Modelo da cena obj (padrão: Deer.obj)" << std::endl;
+    std::cout << "  --accel <bvh|wide|grid> - Estrutura de aceleração (padrão: bvh)" << std::endl;
+    std::cout << "  --bvh <quality|fast|treelet> - Construção da BVH (padrão: quality)" << std::endl;
+    std::cout << "  --threads <N>      - Threads de renderização (padrão: todos os núcleos)" << std::endl;
+    std::cout << "  --packet <2|4|8>   - Traça os raios primários em blocos NxN" << std::endl;
+    std::cout << "  --json <arquivo>   - Salva os resultados em JSON" << std::endl;
+    std::cout << "  --csv <arquivo>    - Salva os resultados em CSV" << std::endl;
+}
+
+// Primeira linha da saída de um comando, vazia em caso de erro
+static std::string command_output(const char *command) {
+    std::string output;
+    if (FILE *pipe = popen(command, "r")) {
+        char line[256];
+        if (fgets(line, sizeof(line), pipe)) {
+            output = line;
+        }
+        pclose(pipe);
+    }
+    while (!output.empty() && (output.back() == '\n' || output.back() == '\r')) {
+        output.pop_back();
+    }
+    return output;
+}
+
+static std::string cpu_model() {
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.rfind("model name", 0) == 0) {
+            return line.substr(line.find(':') + 2);
+        }
+    }
+    return "unknown";
+}
+
+static std::string json_escape(const std::string &text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+static BenchResult measure(Renderer &renderer, const BenchScene &scene, const BenchPose &pose, int width,
+                           int height, int warmup, int frames) {
+    renderer.clear_scene();
+    renderer.set_size(width, height);
+    scene.construct();
+
+    Camera camera = renderer.get_camera();
+    camera.rotate(pose.yaw, pose.pitch);
+    camera.move(pose.dx, pose.dy, pose.dz);
+    renderer.set_camera(camera);
+
+    auto build_start = std::chrono::steady_clock::now();
+    renderer.build_acceleration();
+    auto build_end = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < warmup; i++) {
+        renderer.invalidate_image();
+        renderer.render_frame();
+    }
+
+    // Sem invalidar, os quadros seguintes ao primeiro apenas refariam o sombreamento a partir do G-buffer
+    std::vector<double> times;
+    for (int i = 0; i < frames; i++) {
+        renderer.invalidate_image();
+        auto start = std::chrono::steady_clock::now();
+        renderer.render_frame();
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::sort(times.begin(), times.end());
+
+    BenchResult result;
+    result.scene = scene.name;
+    result.pose = pose.name;
+    result.width = width;
+    result.height = height;
+    result.triangles = renderer.get_triangle_count();
+    result.build_ms = std::chrono::duration<double, std::milli>(build_end - build_start).count();
+    result.sah_cost = renderer.get_sah_cost();
+    result.min_ms = times.front();
+    result.median_ms = times.size() % 2 == 1 ? times[times.size() / 2]
+                                              : (times[times.size() / 2 - 1] + times[times.size() / 2]) / 2.0;
+    // Percentil por posição mais próxima
+    result.p95_ms = times[static_cast<size_t>(std::ceil(0.95 * times.size())) - 1];
+    result.counters = renderer.get_frame_counters();
+    const double rays = static_cast<double>(result.counters.primary_rays + result.counters.shadow_rays);
+    result.mrays_per_s = rays / (result.median_ms * 1000.0);
+    return result;
+}
+
+int main(int argc, char **argv) {
+    Renderer &renderer = Renderer::get_instance();
+    int warmup = 2;
+    int frames = 10;
+    std::vector<std::pair<int, int>> sizes;
+    std::string obj_path = "Deer.obj";
+    std::string accel = "bvh";
+    std::string bvh_build = "quality";
+    int packet_size = 1;
+    std::string json_path;
+    std::string csv_path;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--warmup" && i + 1 < argc) {
+            warmup = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--frames" && i + 1 < argc) {
+            frames = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--size" && i + 1 < argc) {
+            int width = 0;
+            int height = 0;
+            if (std::sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            sizes.emplace_back(width, height);
+        } else if (arg == "--obj" && i + 1 < argc) {
+            obj_path = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            renderer.set_thread_count(std::max(0, std::atoi(argv[++i])));
+        } else if (arg == "--accel" && i + 1 < argc) {
+            accel = argv[++i];
+            if (accel == "bvh") {
+                renderer.set_accelerator(AcceleratorType::BVH);
+            } else if (accel == "wide") {
+                renderer.set_accelerator(AcceleratorType::Wide);
+            } else if (accel == "grid") {
+                renderer.set_accelerator(AcceleratorType::Grid);
+            } else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--bvh" && i + 1 < argc) {
+            bvh_build = argv[++i];
+            if (bvh_build == "quality") {
+                renderer.set_bvh_build(BVHBuildMode::Quality);
+            } else if (bvh_build == "fast") {
+                renderer.set_bvh_build(BVHBuildMode::Fast);
+            } else if (bvh_build == "treelet") {
+                renderer.set_bvh_build(BVHBuildMode::Treelet);
+            } else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--packet" && i + 1 < argc) {
+            packet_size = std::atoi(argv[++i]);
+            if (packet_size != 2 && packet_size != 4 && packet_size != 8) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            renderer.set_packet_size(packet_size);
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (arg == "--csv" && i + 1 < argc) {
+            csv_path = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (sizes.empty()) {
+        sizes = {{640, 480}, {1280, 720}};
+    }
+
+    const std::vector<BenchScene> scenes = {
+        {"cubes", Scenes::construct_cubes},
+        {"towers", Scenes::construct_towers},
+        {"walls", Scenes::construct_walls},
+        {"lights", Scenes::construct_lights},
+        {"obj " + obj_path, [&] { Scenes::load_obj(obj_path.c_str()); }},
+    };
+
+    std::vector<BenchResult> results;
+    for (const BenchScene &scene : scenes) {
+        for (const auto &[width, height] : sizes) {
+            for (const BenchPose &pose : poses) {
+                results.push_back(measure(renderer, scene, pose, width, height, warmup, frames));
+                const BenchResult &r = results.back();
+                // Um quadro sem raios primários não mediu o traçado
+                if (r.counters.primary_rays == 0) {
+                    std::cout << "Erro: nenhum raio primário traçado em " << r.scene << " " << r.width << "x"
+                              << r.height << " " << r.pose << std::endl;
+                    return 1;
+                }
+                std::printf("%-16s %5dx%-5d %-8s min %8.2fms  mediana %8.2fms  p95 %8.2fms  %7.2f Mrays/s"
+                            "  construção %8.2fms  SAH %7.2f\n",
+                            r.scene.c_str(), r.width, r.height, r.pose.c_str(), r.min_ms, r.median_ms, r.p95_ms,
+                            r.mrays_per_s, r.build_ms, r.sah_cost);
+            }
+        }
+    }
+
+    const int threads = renderer.get_thread_count();
+#ifdef __AVX2__
+    const char *simd = "avx2";
+#else
+    const char *simd = "sse";
+#endif
+    const std::string git_rev = command_output("git rev-parse --short HEAD 2>/dev/null");
+
+    if (!json_path.empty()) {
+        std::ofstream json(json_path);
+        json << "{\n";
+        json << "  \"git_rev\": \"" << json_escape(git_rev) << "\",\n";
+        json << "  \"cpu\": \"" << json_escape(cpu_model()) << "\",\n";
+        json << "  \"threads\": " << threads << ",\n";
+        json << "  \"compiler\": \"" << json_escape(__VERSION__) << "\",\n";
+        json << "  \"simd\": \"" << simd << "\",\n";
+        json << "  \"accel\": \"" << accel << "\",\n";
+        json << "  \"bvh\": \"" << bvh_build << "\",\n";
+        json << "  \"packet\": " << packet_size << ",\n";
+        json << "  \"warmup\": " << warmup << ",\n";
+        json << "  \"frames\": " << frames << ",\n";
+        json << "  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const BenchResult &r = results[i];
+            json << "    {\"scene\": \"" << json_escape(r.scene) << "\", \"pose\": \"" << r.pose
+                 << "\", \"width\": " << r.width << ", \"height\": " << r.height << ", \"triangles\": " << r.triangles
+                 << ", \"build_ms\": " << r.build_ms << ", \"sah_cost\": " << r.sah_cost << ", \"min_ms\": " << r.min_ms
+                 << ", \"median_ms\": " << r.median_ms << ", \"p95_ms\": " << r.p95_ms
+                 << ", \"mrays_per_s\": " << r.mrays_per_s << ", \"primary_rays\": " << r.counters.primary_rays
+                 << ", \"shadow_rays\": " << r.counters.shadow_rays << ", \"node_visits\": " << r.counters.node_visits
+                 << ", \"primitive_tests\": " << r.counters.primitive_tests << "}"
+                 << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        json << "  ]\n}\n";
+    }
+
+    if (!csv_path.empty()) {
+        std::ofstream csv(csv_path);
+        csv << "git_rev,threads,simd,accel,bvh,packet,scene,pose,width,height,triangles,build_ms,sah_cost,min_ms,median_ms,p95_ms,"
+               "mrays_per_s,primary_rays,shadow_rays,node_visits,primitive_tests\n";
+        for (const BenchResult &r : results) {
+            csv << git_rev << "," << threads << "," << simd << "," << accel << "," << bvh_build << "," << packet_size << ","
+                << r.scene << "," << r.pose << "," << r.width << "," << r.height << "," << r.triangles << ","
+                << r.build_ms << "," << r.sah_cost << "," << r.min_ms << "," << r.median_ms << "," << r.p95_ms << "," << r.mrays_per_s
+                << "," << r.counters.primary_rays << "," << r.counters.shadow_rays << "," << r.counters.node_visits
+                << "," << r.counters.primitive_tests << "\n";
+        }
+    }
+
+    return 0;
+}
@@ -1,32 +1,178 @@
-#include <GL/glut.h>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
 #include "Renderer.h"
 #include "Scenes.h"
 
+// O executável headless é compilado sem GLUT/OpenGL e sempre renderiza para arquivo
+#ifdef RAYCAST_HEADLESS
+static constexpr bool headless_only = true;
+#else
+static constexpr bool headless_only = false;
+#endif
+
+static void print_usage(const char *program) {
+    std::cout << "Uso: " << program << " [opções] <cena> " << std::endl;
+    std::cout << "Comandos disponíveis:" << std::endl;
+    std::cout << "  obj <arquivo>    - Carrega cena de arquivo OBJ" << std::endl;
+    std::cout << "  herd <arquivo>   - Constrói cena com dez mil instâncias de um arquivo OBJ" << std::endl;
+    std::cout << "  towers           - Constrói cena com torres" << std::endl;
+    std::cout << "  walls            - Constrói cena com paredes" << std::endl;
+    std::cout << "  cubes            - Constrói cena com cubos" << std::endl;
+    std::cout << "  lights           - Constrói cena com centenas de luzes" << std::endl;
+    std::cout << "Opções:" << std::endl;
+    std::cout << "  --packet <2|4|8> - Traça os raios primários em blocos NxN" << std::endl;
+    std::cout << "  --accel <bvh|wide|grid> - Estrutura de aceleração (padrão: bvh)" << std::endl;
+    std::cout << "  --bvh <quality|fast|treelet> - Construção da BVH: SAH, LBVH ou LBVH com treelets (padrão: quality)"
+              << std::endl;
+    std::cout << "  --threads <N>    - Threads de renderização (padrão: todos os núcleos)" << std::endl;
+    std::cout << "  --light-cutoff <v> - Ignora luzes com intensidade abaixo de v (padrão: 1/256, 0 avalia todas)" << std::endl;
+    std::cout << "  --progressive    - Imagem grosseira durante o movimento, refinada depois (tecla P)" << std::endl;
+    std::cout << "  --heatmap <prims|nodes|shadows|cycles> - Pinta o custo de cada pixel (tecla H)" << std::endl;
+    std::cout << "  --overlay        - Mostra tempos por etapa e contadores sobre a imagem (tecla M)" << std::endl;
+    std::cout << "  --metrics <arquivo> - Grava as métricas dos últimos quadros em CSV ao sair" << std::endl;
+    std::cout << "  --headless       - Renderiza um quadro sem janela e salva em arquivo" << std::endl;
+    std::cout << "  --out <arquivo>  - Arquivo PPM de saída do modo headless (padrão: frame.ppm)" << std::endl;
+    std::cout << "  --compare <arquivo> - Compara a imagem do modo headless com um PPM de referência" << std::endl;
+    std::cout << "  --size <LxA>     - Resolução da imagem (padrão: 800x600)" << std::endl;
+}
+
 int main(int argc, char **argv) {
-    if (argc >= 2) {
-        std::string command = argv[1];
+    Renderer &renderer = Renderer::get_instance();
+    bool headless = headless_only;
+    std::string out_path = "frame.ppm";
+    std::string compare_path;
+
+    // Separa as opções dos argumentos da cena
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--packet" && i + 1 < argc) {
+            const int packet_size = std::atoi(argv[++i]);
+            if (packet_size != 2 && packet_size != 4 && packet_size != 8) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            renderer.set_packet_size(packet_size);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            renderer.set_thread_count(std::max(0, std::atoi(argv[++i])));
+        } else if (arg == "--accel" && i + 1 < argc) {
+            const std::string type = argv[++i];
+            if (type == "bvh") {
+                renderer.set_accelerator(AcceleratorType::BVH);
+            } else if (type == "wide") {
+                renderer.set_accelerator(AcceleratorType::Wide);
+            } else if (type == "grid") {
+                renderer.set_accelerator(AcceleratorType::Grid);
+            } else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--bvh" && i + 1 < argc) {
+            const std::string mode = argv[++i];
+            if (mode == "quality") {
+                renderer.set_bvh_build(BVHBuildMode::Quality);
+            } else if (mode == "fast") {
+                renderer.set_bvh_build(BVHBuildMode::Fast);
+            } else if (mode == "treelet") {
+                renderer.set_bvh_build(BVHBuildMode::Treelet);
+            } else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--light-cutoff" && i + 1 < argc) {
+            renderer.set_light_cutoff(std::atof(argv[++i]));
+        } else if (arg == "--progressive") {
+            renderer.set_progressive(true);
+        } else if (arg == "--heatmap" && i + 1 < argc) {
+            const std::string mode = argv[++i];
+            if (mode == "prims") {
+                renderer.set_heatmap(HeatmapMode::PrimitiveTests);
+            } else if (mode == "nodes") {
+                renderer.set_heatmap(HeatmapMode::NodeVisits);
+            } else if (mode == "shadows") {
+                renderer.set_heatmap(HeatmapMode::ShadowRays);
+            } else if (mode == "cycles") {
+                renderer.set_heatmap(HeatmapMode::Cycles);
+            } else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--overlay") {
+            renderer.set_overlay(true);
+        } else if (arg == "--metrics" && i + 1 < argc) {
+            renderer.set_metrics_path(argv[++i]);
+        } else if (arg == "--headless") {
+            headless = true;
+        } else if (arg == "--out" && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (arg == "--compare" && i + 1 < argc) {
+            compare_path = argv[++i];
+        } else if (arg == "--size" && i + 1 < argc) {
+            int width = 0;
+            int height = 0;
+            if (std::sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            renderer.set_size(width, height);
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (!args.empty()) {
+        const std::string &command = args[0];
 
-        if (command == "obj" && argc == 3) {
-            Scenes::load_obj(argv[2]);
+        if (command == "obj" && args.size() == 2) {
+            Scenes::load_obj(args[1].c_str());
+        } else if (command == "herd" && args.size() == 2) {
+            Scenes::construct_herd(args[1].c_str());
         } else if (command == "towers") {
             Scenes::construct_towers();
         } else if (command == "walls") {
             Scenes::construct_walls();
         } else if (command == "cubes") {
             Scenes::construct_cubes();
+        } else if (command == "lights") {
+            Scenes::construct_lights();
         } else {
-            std::cout << "Uso: " << argv[0] << " <cena> " << std::endl;
-            std::cout << "Comandos disponíveis:" << std::endl;
-            std::cout << "  obj <arquivo>    - Carrega cena de arquivo OBJ" << std::endl;
-            std::cout << "  towers           - Constrói cena com torres" << std::endl;
-            std::cout << "  walls            - Constrói cena com paredes" << std::endl;
-            std::cout << "  cubes            - Constrói cena com cubos" << std::endl;
+            print_usage(argv[0]);
             return 1;
         }
     } else {
         Scenes::construct_cubes();
     }
 
-    Renderer::get_instance().init(argc, argv);
+    renderer.build_acceleration();
+
+    if (headless) {
+        renderer.render_frame();
+        std::cout << "Tempo de renderização: " << renderer.get_metrics().last().frame_ms << "ms" << std::endl;
+        if (renderer.get_heatmap() != HeatmapMode::Off) {
+            std::cout << "Mapa de calor (" << Renderer::heatmap_name(renderer.get_heatmap())
+                      << "): vermelho = " << renderer.get_heatmap_max() << " por pixel" << std::endl;
+        }
+        if (!renderer.save_ppm(out_path.c_str())) {
+            std::cout << "Erro: não foi possível salvar " << out_path << std::endl;
+            return 1;
+        }
+        // Verificação de regressão: falha se algum pixel difere da imagem de referência
+        if (!compare_path.empty()) {
+            const long differing = renderer.compare_ppm(compare_path.c_str());
+            if (differing < 0) {
+                std::cout << "Erro: não foi possível comparar com " << compare_path << std::endl;
+                return 1;
+            }
+            std::cout << "Pixels diferentes de " << compare_path << ": " << differing << std::endl;
+            return differing == 0 ? 0 : 1;
+        }
+        return 0;
+    }
+
+#ifndef RAYCAST_HEADLESS
+    renderer.init(argc, argv);
+#endif
     return 0;
 }